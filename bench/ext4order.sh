@@ -0,0 +1,69 @@
+#!/bin/sh
+# Traversal orders on loop-mounted ext4 image with cold cache (needs root).
+#
+# Builds image with tree of a x b x c directories and f empty files in every leaf, created in random order
+# (like tree grown over years - readdir hash order, inode order and disk order differ), and runs
+# bench/orderbench on it: readdir, inode and extent order, then inode and extent order with read ahead (-D).
+#
+# IOPS=n throttles reads of loop device to n per second (cgroup v1 blkio or v2 io.max) - loop device on
+# SSD or virtio disk has no seek cost, throttled one at least makes every read that isn't merged cost the same.
+# Reads queued by throttle and not used by one run (read ahead) are charged to next one, so with IOPS every
+# run is separate orderbench started after PAUSE seconds (default 20).
+#
+# Usage: bench/ext4order.sh [a b c f]   (default 40 20 10 8; IMG, MNT, RUNS, IOPS and PAUSE can be set in environment)
+set -e
+A=${1:-40}; B=${2:-20}; C=${3:-10}; F=${4:-8}
+IMG=${IMG:-/tmp/fileseeker-ext4.img}
+MNT=${MNT:-/tmp/fileseeker-ext4}
+RUNS=${RUNS:-3}
+IOPS=${IOPS:-}
+PAUSE=${PAUSE:-20}
+BENCH=$(dirname "$0")/orderbench
+
+[ -x "$BENCH" ] || { echo "build it first: make bench" >&2; exit 1; }
+rm -f "$IMG"
+truncate -s 2G "$IMG"
+mkfs.ext4 -q -F "$IMG"
+mkdir -p "$MNT"
+mount -o loop "$IMG" "$MNT"
+CG=
+trap 'if [ -n "$CG" ]; then echo $$ > "$(dirname "$CG")/cgroup.procs"; rmdir "$CG"; fi; umount "$MNT"; rm -f "$IMG"' EXIT
+
+echo "creating $((A*B*C)) directories with $F files each in random order..."
+cd "$MNT"
+awk -v a="$A" -v b="$B" -v c="$C" 'BEGIN{for(i=0;i<a;i++) for(j=0;j<b;j++) for(k=0;k<c;k++) printf "d%03d/s%03d/l%03d\n", i, j, k}' | shuf | xargs mkdir -p
+find . -mindepth 3 -type d | awk -v f="$F" '{for(i=0;i<f;i++) printf "%s/file%02d.dat\n", $0, i}' | shuf | xargs touch
+cd - >/dev/null
+sync
+
+LOOP=$(basename "$(losetup -j "$IMG" | cut -d: -f1 | head -1)")
+echo "loop device rotational: $(cat /sys/block/$LOOP/queue/rotational)"
+if [ -n "$IOPS" ]; then
+	DEV=$(cat /sys/block/$LOOP/dev)
+	if [ -d /sys/fs/cgroup/blkio ]; then
+		CG=/sys/fs/cgroup/blkio/fileseeker-ext4
+		mkdir -p "$CG"
+		echo "$DEV $IOPS" > "$CG/blkio.throttle.read_iops_device"
+	else
+		CG=/sys/fs/cgroup/fileseeker-ext4
+		echo +io > /sys/fs/cgroup/cgroup.subtree_control
+		mkdir -p "$CG"
+		echo "$DEV riops=$IOPS" > "$CG/io.max"
+	fi
+	echo $$ > "$CG/cgroup.procs"
+	echo "reads throttled to $IOPS per second, $PAUSE s pause before every run"
+	for guard in "" "-D 5000"; do
+		echo "${guard:-no guard}:"
+		for order in readdir inode extent; do
+			i=0
+			while [ $i -lt "$RUNS" ]; do
+				sleep "$PAUSE"
+				"$BENCH" -c -n 1 $guard -o $order "$MNT" | tail -n 1
+				i=$((i+1))
+			done
+		done
+	done
+	exit 0
+fi
+"$BENCH" -c -n "$RUNS" "$MNT"
+"$BENCH" -c -n "$RUNS" -D 5000 -o readdir -o inode -o extent "$MNT"
@@ -0,0 +1,256 @@
+/** @file matchbench.c
+ *  @brief Microbenchmark of name matching strategies and of traversal inner loop.
+ *
+ * Benchmark runs corpus of names (-c file with one name per line, e.g. captured with find / -xdev -printf '%f\n'; synthetic corpus by default) through every matching strategy from matcher.c. Every strategy gets warmup runs and then measured runs; report shows ns/name (mean, standard deviation, min, max) and count of matches, which must be the same for all strategies except glob with wildcard patterns. With -t listing (recorded with find / -xdev -printf '%y %p\n') it also measures whole traversal inner loop per entry - traversal core of daemon and libfileseeker (walk.c: replay backend listing, path joining, matching against set matcher and matchers of single patterns, counting against limits, collecting subdirectories) in readdir order. Traversal counts matches per pattern, so name matching two patterns counts twice there.
+ *
+ * Usage: matchbench [-c corpus] [-p pattern]... [-n runs] [-w warmup] [-t listing]
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "../src/matcher.h"
+#include "../src/backend.h"
+#include "../src/walk.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define max_patterns 64
+
+/** @brief corpus - names with their lengths. */
+static char** names = NULL;
+static size_t* lengths = NULL;
+static size_t name_count = 0;
+
+static void corpus_add(const char* name, size_t len){
+	static size_t capacity = 0;
+	if(name_count==capacity){
+		capacity = capacity ? capacity*2 : 4096;
+		names = realloc(names, sizeof(char*)*capacity);
+		lengths = realloc(lengths, sizeof(size_t)*capacity);
+		if(!names || !lengths)
+			abort();
+	}
+	names[name_count] = strndup(name, len);
+	lengths[name_count++] = len;
+}
+
+/** @brief loads names, one per line. */
+static int corpus_load(const char* file){
+	FILE* f = fopen(file, "r");
+	if(!f)
+		return 1;
+	char* line = NULL;
+	size_t cap = 0;
+	ssize_t len;
+	while((len = getline(&line, &cap, f))>0){
+		if(line[len-1]=='\n')
+			len--;
+		if(len)
+			corpus_add(line, len);
+	}
+	free(line);
+	fclose(f);
+	return 0;
+}
+
+static uint64_t rng_state = 88172645463325252ull;
+static uint64_t rng(){
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+/** @brief synthetic corpus - mix of common names and random ones with realistic lengths. */
+static void corpus_generate(size_t n){
+	static const char* common[] = {"node_modules", "index.js", "__init__.py", "package.json", "README.md", "LICENSE",
+		"Makefile", "__pycache__", "main.c", "utils.py", "index.d.ts", "config.yaml", "libc.so.6", "passwd", ".bashrc"};
+	static const char* ext[] = {".c", ".h", ".py", ".js", ".so", ".txt", ".json", ".gz", ""};
+	char name[256];
+	for(size_t i=0;i<n;i++){
+		if(rng()%4==0){
+			snprintf(name, sizeof(name), "%s", common[rng()%(sizeof(common)/sizeof(*common))]);
+		} else {
+			int len = 3+rng()%20;
+			for(int j=0;j<len;j++)
+				name[j] = "abcdefghijklmnopqrstuvwxyz_-0123456789"[rng()%38];
+			snprintf(name+len, sizeof(name)-len, "%s", ext[rng()%(sizeof(ext)/sizeof(*ext))]);
+		}
+		corpus_add(name, strlen(name));
+	}
+}
+
+static double now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+/** @brief result of measured runs. */
+typedef struct stats {
+	double mean;
+	double stddev;
+	double min;
+	double max;
+} stats;
+
+static stats compute(const double* v, int n){
+	stats s = {0, 0, v[0], v[0]};
+	for(int i=0;i<n;i++){
+		s.mean += v[i];
+		if(v[i]<s.min)
+			s.min = v[i];
+		if(v[i]>s.max)
+			s.max = v[i];
+	}
+	s.mean /= n;
+	for(int i=0;i<n;i++)
+		s.stddev += (v[i]-s.mean)*(v[i]-s.mean);
+	s.stddev = n>1 ? sqrt(s.stddev/(n-1)) : 0;
+	return s;
+}
+
+/** @brief one pass of corpus through matcher.
+ * @return count of matching names.
+ */
+static size_t match_pass(const matcher* m){
+	size_t found = 0;
+	for(size_t i=0;i<name_count;i++)
+		found += matcher_match(m, names[i], lengths[i])>=0;
+	return found;
+}
+
+/** @brief recursion of search_rec over traversal core - list (match, collect subdirectories), visit subdirectories. */
+static void walk(walk_ctx* w, const char* root_path, size_t* entries, size_t* found){
+	walk_listing l = {0};
+	if(walk_list(w, root_path, NULL, &l)!=walk_listed)
+		return;
+	*entries += l.entries;
+	*found += l.matches;
+	char path[walk_path_len];
+	for(uint32_t i=0;i<l.count;i++){
+		walk_path(path, root_path, l.subdirs[i].name);
+		walk(w, path, entries, found);
+	}
+	walk_listing_free(&l);
+}
+
+int main(int argc, char** argv){
+	char* patterns[max_patterns];
+	int pattern_count = 0;
+	const char* corpus = NULL;
+	const char* listing = NULL;
+	int runs = 10, warmup = 2;
+	int opt;
+	while((opt = getopt(argc, argv, "c:p:n:w:t:"))!=-1){
+		switch (opt) {
+			case 'c':
+				corpus = optarg;
+			break;
+			case 'p':
+				if(pattern_count<max_patterns)
+					patterns[pattern_count++] = optarg;
+			break;
+			case 'n':
+				runs = atoi(optarg);
+			break;
+			case 'w':
+				warmup = atoi(optarg);
+			break;
+			case 't':
+				listing = optarg;
+			break;
+			default:
+				fprintf(stderr, "Usage: %s [-c corpus] [-p pattern]... [-n runs] [-w warmup] [-t listing]\n", argv[0]);
+				return 2;
+		}
+	}
+	if(runs<1)
+		runs = 1;
+	if(!pattern_count){
+		static char* defaults[] = {"passwd", "id_rsa", "secret", ".pem"};
+		for(int i=0;i<4;i++)
+			patterns[pattern_count++] = defaults[i];
+	}
+	if(corpus){
+		if(corpus_load(corpus)){
+			perror(corpus);
+			return 1;
+		}
+	} else {
+		corpus_generate(1000000);
+	}
+	if(!name_count){
+		fprintf(stderr, "empty corpus\n");
+		return 1;
+	}
+	size_t total_len = 0;
+	for(size_t i=0;i<name_count;i++)
+		total_len += lengths[i];
+	printf("corpus: %zu names (%s), mean length %.1f; %d patterns; %d warmup + %d runs\n",
+		name_count, corpus ? corpus : "synthetic", (double) total_len/name_count, pattern_count, warmup, runs);
+	printf("%-8s %10s %10s %10s %10s %10s\n", "matcher", "ns/name", "stddev", "min", "max", "matches");
+
+	double* samples = malloc(sizeof(double)*runs);
+	for(int kind=0;kind<matcher_kinds;kind++){
+		matcher* m = matcher_create(kind, patterns, pattern_count);
+		if(!m)
+			return 1;
+		size_t found = 0;
+		for(int i=0;i<warmup;i++)
+			found = match_pass(m);
+		for(int i=0;i<runs;i++){
+			double t0 = now();
+			found = match_pass(m);
+			samples[i] = (now()-t0)*1e9/name_count;
+		}
+		stats s = compute(samples, runs);
+		printf("%-8s %10.2f %10.2f %10.2f %10.2f %10zu\n", matcher_name(kind), s.mean, s.stddev, s.min, s.max, found);
+		matcher_free(m);
+	}
+
+	if(listing){
+		replay_tree* t = malloc(sizeof(replay_tree));
+		fs_backend* b;
+		if(!t || replay_tree_load(t, listing) || !(b = backend_replay_tree(t))){
+			fprintf(stderr, "can't load listing %s\n", listing);
+			return 1;
+		}
+		printf("traversal inner loop (replay backend, %u nodes):\n", t->ps.count);
+		printf("%-8s %10s %10s %10s %10s %10s\n", "matcher", "ns/entry", "stddev", "min", "Mentry/s", "matches");
+		/** patterns without limits - every match is counted */
+		int limits[max_patterns] = {0};
+		for(int kind=0;kind<matcher_kinds;kind++){
+			walk_ctx w;
+			if(walk_init(&w, b, kind, order_readdir, patterns, limits, pattern_count, NULL)){
+				fprintf(stderr, "can't compile patterns for %s\n", matcher_name(kind));
+				return 1;
+			}
+			size_t entries = 0, found = 0;
+			for(int i=0;i<warmup;i++){
+				entries = found = 0;
+				walk(&w, "/", &entries, &found);
+			}
+			for(int i=0;i<runs;i++){
+				entries = found = 0;
+				double t0 = now();
+				walk(&w, "/", &entries, &found);
+				samples[i] = (now()-t0)*1e9/(entries ? entries : 1);
+			}
+			stats s = compute(samples, runs);
+			printf("%-8s %10.2f %10.2f %10.2f %10.2f %10zu\n", matcher_name(kind), s.mean, s.stddev, s.min, 1e3/s.mean, found);
+			walk_free(&w);
+		}
+		b->destroy(b);
+	}
+	free(samples);
+	for(size_t i=0;i<name_count;i++)
+		free(names[i]);
+	free(names);
+	free(lengths);
+	return 0;
+}
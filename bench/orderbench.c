@@ -0,0 +1,141 @@
+/** @file orderbench.c
+ *  @brief Benchmark of traversal orders on real filesystem - readdir, inode and extent.
+ *
+ * Walks directory tree with traversal core of search_rec and libfileseeker (walk.c - subdirectories collected and visited in readdir, inode or FIEMAP first-block order, next ones announced to backend ahead), without patterns, with posix or getdents backend, optionally wrapped by guard backend (-D ms) which reads announced directories ahead in helper threads. With -c page cache is dropped before every run (needs root), so every run reads from disk - that's where order matters; on loop-mounted ext4 image with throttled reads (see ext4order.sh) inode and extent order need a quarter of reads of readdir order, extent order isn't faster than inode order.
+ *
+ * Usage: orderbench [-o order]... [-b backend] [-D ms] [-t threads] [-n runs] [-c] dir
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "../src/fileseeker.h"
+
+/** @brief guard backend stops waiting when scan is stopped - here it never is. */
+volatile sig_atomic_t flag = flag_scan;
+int verbose = 0;
+
+static double now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+/** @brief counters of one run. */
+typedef struct walk_stats {
+	size_t dirs;
+	size_t entries;
+	size_t skipped;
+} walk_stats;
+
+/** @brief recursion of search_rec over the same core - list, order, announce next subdirectories, visit. */
+static void walk(walk_ctx* w, const char* root_path, walk_stats* st){
+	walk_listing l = {0};
+	if(walk_list(w, root_path, NULL, &l)!=walk_listed){
+		st->skipped++;
+		return;
+	}
+	st->dirs++;
+	st->entries += l.entries;
+	walk_order(w, root_path, &l);
+	char path[walk_path_len];
+	for(uint32_t i=0;i<l.count;i++){
+		if(w->order!=order_readdir)
+			walk_prefetch(w, root_path, &l, i);
+		walk_path(path, root_path, l.subdirs[i].name);
+		walk(w, path, st);
+	}
+	walk_listing_free(&l);
+}
+
+/** @brief writes back dirty pages and drops page, dentry and inode caches. */
+static int drop_caches(){
+	sync();
+	int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+	if(fd<0)
+		return 1;
+	int err = write(fd, "3", 1)!=1;
+	close(fd);
+	return err;
+}
+
+int main(int argc, char** argv){
+	int order_list[8];
+	int order_count = 0;
+	const char* spec = "getdents";
+	int runs = 3, cold = 0;
+	int opt;
+	while((opt = getopt(argc, argv, "o:b:D:t:n:c"))!=-1){
+		switch (opt) {
+			case 'o':
+				if(order_count<8 && (order_list[order_count] = order_parse(optarg))>=0 && order_list[order_count]!=order_hot)
+					order_count++;
+				else
+					fprintf(stderr, "skipping order %s\n", optarg);
+			break;
+			case 'b':
+				spec = optarg;
+			break;
+			case 'D':
+				dir_timeout = atoi(optarg);
+			break;
+			case 't':
+				guard_threads = atoi(optarg)>0 ? atoi(optarg) : guard_threads;
+			break;
+			case 'n':
+				runs = atoi(optarg)>0 ? atoi(optarg) : 1;
+			break;
+			case 'c':
+				cold = 1;
+			break;
+			default:
+				fprintf(stderr, "Usage: %s [-o order]... [-b backend] [-D ms] [-t threads] [-n runs] [-c] dir\n", argv[0]);
+				return 2;
+		}
+	}
+	if(optind>=argc){
+		fprintf(stderr, "Usage: %s [-o order]... [-b backend] [-D ms] [-t threads] [-n runs] [-c] dir\n", argv[0]);
+		return 2;
+	}
+	const char* root = argv[optind];
+	if(!order_count){
+		order_list[order_count++] = order_readdir;
+		order_list[order_count++] = order_inode;
+		order_list[order_count++] = order_extent;
+	}
+	fs_backend* b = backend_create(spec);
+	if(!b || (dir_timeout>0 && !(b = backend_guard(b)))){
+		fprintf(stderr, "can't create backend %s\n", spec);
+		return 1;
+	}
+	if(cold && drop_caches()){
+		perror("drop_caches");
+		return 1;
+	}
+	printf("%s: backend %s%s, %s cache, %d runs\n", root, spec, dir_timeout>0 ? " + guard (read ahead)" : "", cold ? "cold" : "warm", runs);
+	printf("%-8s %10s %10s %10s %10s %10s\n", "order", "mean s", "min s", "dirs", "entries", "skipped");
+	for(int o=0;o<order_count;o++){
+		double sum = 0, min = 0;
+		walk_stats st;
+		for(int i=0;i<runs;i++){
+			if(cold)
+				drop_caches();
+			memset(&st, 0, sizeof(st));
+			if(b->prefetch)
+				b->prefetch(b, NULL);
+			walk_ctx w;
+			if(walk_init(&w, b, matcher_strstr, order_list[o], NULL, NULL, 0, NULL)){
+				fprintf(stderr, "can't start traversal\n");
+				return 1;
+			}
+			double t0 = now();
+			walk(&w, root, &st);
+			double t = now()-t0;
+			walk_free(&w);
+			sum += t;
+			if(!i || t<min)
+				min = t;
+		}
+		printf("%-8s %10.3f %10.3f %10zu %10zu %10zu\n", order_name(order_list[o]), sum/runs, min, st.dirs, st.entries, st.skipped);
+	}
+	return 0;
+}
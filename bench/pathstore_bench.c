@@ -0,0 +1,226 @@
+/** @file pathstore_bench.c
+ *  @brief Benchmark of compact path store against naive full-path string storage.
+ *
+ * Benchmark builds the same set of paths twice: in path store (parent index + interned name per node) and naively as one malloc'ed string per entry indexed by hash table of full paths. Paths come from real directory tree (-r dir) or from synthetic tree (-n entries) with realistic share of repeated names (node_modules, index.js, __init__.py...). It reports bytes per entry of both representations (and of fixed MAX_PATH_LEN buffers), lookup throughput of full paths and throughput of path rebuilding.
+ *
+ * Usage: pathstore_bench [-n entries] [-r dir] [-l lookups]
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "../src/pathstore.h"
+#include <ftw.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_PATH_LEN 2048
+
+/** @brief list of generated/collected paths - input of benchmark. */
+static char** paths = NULL;
+static size_t path_count = 0;
+static size_t path_capacity = 0;
+
+static void paths_add(const char* path){
+	if(path_count==path_capacity){
+		path_capacity = path_capacity ? path_capacity*2 : 4096;
+		paths = realloc(paths, sizeof(char*)*path_capacity);
+		if(!paths)
+			abort();
+	}
+	paths[path_count++] = strdup(path);
+}
+
+static int collect(const char* path, const struct stat* st, int type, struct FTW* ftw){
+	paths_add(path);
+	return 0;
+}
+
+/** @brief simple xorshift generator - same synthetic tree on every run. */
+static uint64_t rng_state = 88172645463325252ull;
+static uint64_t rng(){
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+/** @brief names which repeat all over real trees. */
+static const char* common_names[] = {
+	"node_modules", "index.js", "__init__.py", "package.json", "README.md", "LICENSE", "src", "lib",
+	"test", "tests", "dist", "build", "include", "Makefile", "__pycache__", ".git", "objects", "refs",
+	"main.c", "utils.py", "index.d.ts", "CHANGELOG.md", "config", "share", "doc", "man", "bin", "usr"
+};
+#define common_count (sizeof(common_names)/sizeof(*common_names))
+
+/** @brief generates synthetic tree with n entries; parent paths are kept under ~200 characters. */
+static void generate(size_t n){
+	char path[MAX_PATH_LEN];
+	char name[64];
+	size_t dirs = 1;
+	char** dir_paths = malloc(sizeof(char*)*n);
+	if(!dir_paths)
+		abort();
+	dir_paths[0] = strdup("");
+	while(path_count<n){
+		/** newer directories are more likely parents - trees get deep */
+		size_t parent = dirs - 1 - (rng() % (dirs<64 ? dirs : 64));
+		if(strlen(dir_paths[parent])>200)
+			parent = rng() % dirs;
+		if(rng()%3)
+			snprintf(name, sizeof(name), "%s", common_names[rng()%common_count]);
+		else
+			snprintf(name, sizeof(name), "file_%llu.%s", (unsigned long long) (rng()%100000), (rng()&1) ? "js" : "py");
+		snprintf(path, sizeof(path), "%s/%s", dir_paths[parent], name);
+		paths_add(path);
+		if(rng()%4==0 && dirs<n)
+			dir_paths[dirs++] = strdup(path);
+	}
+	for(size_t i=0;i<dirs;i++)
+		free(dir_paths[i]);
+	free(dir_paths);
+}
+
+/** @brief naive storage - malloc'ed path strings in open addressing hash set. */
+typedef struct naive_set {
+	char** slots;
+	size_t size;
+	size_t count;
+} naive_set;
+
+static uint64_t hash_str(const char* s){
+	uint64_t h = 1469598103934665603ull;
+	while(*s){
+		h ^= (unsigned char) *s++;
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+static void naive_insert(naive_set* set, const char* path){
+	size_t i = hash_str(path) & (set->size-1);
+	while(set->slots[i]){
+		if(!strcmp(set->slots[i], path))
+			return;
+		i = (i+1) & (set->size-1);
+	}
+	set->slots[i] = strdup(path);
+	set->count++;
+}
+
+static const char* naive_lookup(const naive_set* set, const char* path){
+	size_t i = hash_str(path) & (set->size-1);
+	while(set->slots[i]){
+		if(!strcmp(set->slots[i], path))
+			return set->slots[i];
+		i = (i+1) & (set->size-1);
+	}
+	return NULL;
+}
+
+static double now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+int main(int argc, char** argv){
+	size_t n = 1000000;
+	size_t lookups = 2000000;
+	const char* root = NULL;
+	int opt;
+	while((opt = getopt(argc, argv, "n:r:l:"))!=-1){
+		switch (opt) {
+			case 'n':
+				n = strtoull(optarg, NULL, 10);
+			break;
+			case 'r':
+				root = optarg;
+			break;
+			case 'l':
+				lookups = strtoull(optarg, NULL, 10);
+			break;
+			default:
+				fprintf(stderr, "Usage: %s [-n entries] [-r dir] [-l lookups]\n", argv[0]);
+				return 2;
+		}
+	}
+	if(root)
+		nftw(root, collect, 64, FTW_PHYS);
+	else
+		generate(n);
+	if(!path_count){
+		fprintf(stderr, "no paths\n");
+		return 1;
+	}
+	printf("entries: %zu (%s)\n", path_count, root ? root : "synthetic");
+
+	/** compact store */
+	pathstore ps;
+	if(pathstore_init(&ps))
+		return 1;
+	double t0 = now();
+	for(size_t i=0;i<path_count;i++)
+		if(pathstore_insert(&ps, paths[i])==pathstore_none)
+			return 1;
+	double t1 = now();
+
+	/** naive store; bytes counted as malloc really uses them (+8 bytes of chunk header) */
+	naive_set set = {0};
+	set.size = 1;
+	while(set.size<path_count*2)
+		set.size *= 2;
+	set.slots = calloc(set.size, sizeof(char*));
+	double t2 = now();
+	for(size_t i=0;i<path_count;i++)
+		naive_insert(&set, paths[i]);
+	double t3 = now();
+	size_t naive_bytes = set.size*sizeof(char*);
+	for(size_t i=0;i<set.size;i++)
+		if(set.slots[i])
+			naive_bytes += malloc_usable_size(set.slots[i])+8;
+
+	size_t compact_bytes = pathstore_bytes(&ps);
+	printf("nodes: %u, distinct names: %u\n", ps.count, ps.names.count);
+	printf("%-22s %12s %10s %12s\n", "storage", "bytes", "B/entry", "insert ns");
+	printf("%-22s %12zu %10.1f %12s\n", "fixed MAX_PATH_LEN", (size_t) MAX_PATH_LEN*path_count, (double) MAX_PATH_LEN, "-");
+	printf("%-22s %12zu %10.1f %12.1f\n", "naive strings+hash", naive_bytes, (double) naive_bytes/set.count, (t3-t2)*1e9/path_count);
+	printf("%-22s %12zu %10.1f %12.1f\n", "pathstore", compact_bytes, (double) compact_bytes/(ps.count-1), (t1-t0)*1e9/path_count);
+
+	/** lookups of random full paths */
+	size_t* order = malloc(sizeof(size_t)*lookups);
+	for(size_t i=0;i<lookups;i++)
+		order[i] = rng() % path_count;
+	size_t hits = 0;
+	t0 = now();
+	for(size_t i=0;i<lookups;i++)
+		hits += naive_lookup(&set, paths[order[i]])!=NULL;
+	t1 = now();
+	for(size_t i=0;i<lookups;i++)
+		hits += pathstore_lookup(&ps, paths[order[i]])!=pathstore_none;
+	t2 = now();
+	char buf[MAX_PATH_LEN];
+	size_t total = 0;
+	for(size_t i=0;i<lookups;i++)
+		total += pathstore_path(&ps, 1+order[i]%(ps.count-1), buf, sizeof(buf));
+	t3 = now();
+	printf("%-22s %12s %10s\n", "lookup", "Mlookups/s", "ns");
+	printf("%-22s %12.2f %10.1f\n", "naive strings+hash", lookups/(t1-t0)/1e6, (t1-t0)*1e9/lookups);
+	printf("%-22s %12.2f %10.1f\n", "pathstore", lookups/(t2-t1)/1e6, (t2-t1)*1e9/lookups);
+	printf("%-22s %12.2f %10.1f\n", "pathstore rebuild", lookups/(t3-t2)/1e6, (t3-t2)*1e9/lookups);
+	if(hits!=2*lookups)
+		fprintf(stderr, "lookup mismatch: %zu of %zu\n", hits, 2*lookups);
+
+	free(order);
+	for(size_t i=0;i<set.size;i++)
+		free(set.slots[i]);
+	free(set.slots);
+	for(size_t i=0;i<path_count;i++)
+		free(paths[i]);
+	free(paths);
+	pathstore_free(&ps);
+	return total==0;
+}
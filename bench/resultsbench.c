@@ -0,0 +1,128 @@
+/** @file resultsbench.c
+ *  @brief Benchmark of reader latency of published results while writer keeps publishing.
+ *
+ * Writer publishes set of n synthetic paths (results.c, the same code children use with -r). Reader runs the same query again and again and records latency of every query - first while writer is idle, then while another process republishes new set every -p microseconds (like scans finishing one after another). Report shows percentiles of latency for both phases and count of sets reader switched to; with epoch publication they should be the same apart from one remap per publication.
+ *
+ * Usage: resultsbench [-n paths] [-q queries] [-p period_us]
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "../src/results.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+/** @brief fills writer with n paths; seed changes names so every set is different. */
+static void fill(results_writer* w, int n, unsigned int seed){
+	char path[256];
+	results_reset(w);
+	for(int i=0;i<n;i++){
+		snprintf(path, sizeof(path), "/home/user%d/project%u/src/module%d/file%d.c", i%50, seed%7, i%300, i);
+		results_add(w, path, 0);
+	}
+}
+
+static int compare_u64(const void* a, const void* b){
+	uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+	return (x>y) - (x<y);
+}
+
+/** @brief runs queries and prints latency percentiles. */
+static void measure(const char* label, results_reader* r, int queries){
+	uint64_t* lat = malloc(sizeof(uint64_t)*queries);
+	if(!lat)
+		abort();
+	uint64_t first_epoch = r->epoch;
+	long found = 0;
+	for(int i=0;i<queries;i++){
+		uint64_t t0 = now_ns();
+		found += results_query(r, "module42/", NULL, NULL);
+		lat[i] = now_ns()-t0;
+	}
+	qsort(lat, queries, sizeof(uint64_t), compare_u64);
+	printf("%-10s %9.1f %9.1f %9.1f %9.1f %9.1f %8llu %10ld\n", label, lat[queries/2]/1e3, lat[queries*9/10]/1e3,
+		lat[queries*99/100]/1e3, lat[queries*999/1000]/1e3, lat[queries-1]/1e3, (unsigned long long) (r->epoch-first_epoch), found/queries);
+	free(lat);
+}
+
+int main(int argc, char** argv){
+	int n = 10000, queries = 20000, period = 1000;
+	int opt;
+	while((opt = getopt(argc, argv, "n:q:p:"))!=-1){
+		switch (opt) {
+			case 'n':
+				n = atoi(optarg);
+			break;
+			case 'q':
+				queries = atoi(optarg);
+			break;
+			case 'p':
+				period = atoi(optarg);
+			break;
+			default:
+				fprintf(stderr, "Usage: %s [-n paths] [-q queries] [-p period_us]\n", argv[0]);
+				return 2;
+		}
+	}
+	if(n<1 || queries<1)
+		return 2;
+	char name[64];
+	snprintf(name, sizeof(name), "/fileseeker-bench.%d", (int) getpid());
+	results_writer w;
+	if(results_writer_open(&w, name, 0)){
+		perror(name);
+		return 1;
+	}
+	fill(&w, n, 0);
+	if(results_publish(&w, 0)){
+		fprintf(stderr, "can't publish\n");
+		return 1;
+	}
+	results_reader r;
+	if(results_reader_open(&r, name+1)){
+		fprintf(stderr, "can't open %s\n", name);
+		return 1;
+	}
+	results_query(&r, "", NULL, NULL);
+	printf("%d paths per set, %d queries per phase, publication every %d us\n", n, queries, period);
+	printf("%-10s %9s %9s %9s %9s %9s %8s %10s\n", "writer", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us", "epochs", "found");
+	measure("idle", &r, queries);
+
+	pid_t writer = fork();
+	if(writer==0){
+		/** publishing process - new set again and again until killed */
+		for(unsigned int seed=1;;seed++){
+			fill(&w, n, seed);
+			results_publish(&w, 0);
+			usleep(period);
+		}
+	}
+	usleep(10000);
+	measure("publishing", &r, queries);
+	kill(writer, SIGKILL);
+	waitpid(writer, NULL, 0);
+
+	/** remove every set which could be left by killed writer */
+	uint64_t last = w.header->epoch;
+	char set[96];
+	for(uint64_t e=1;e<=last;e++){
+		snprintf(set, sizeof(set), "%s.%llu", name, (unsigned long long) e);
+		shm_unlink(set);
+	}
+	results_reader_close(&r);
+	results_writer_close(&w);
+	shm_unlink(name);
+	return 0;
+}
@@ -0,0 +1,713 @@
+/** @file dupes.c
+ *  @brief Duplicate files search - scan groups candidates, staged hashing confirms them.
+ *
+ * Search runs fs_scan with stat of every match, so traversal is the same as in scan (backend, order, threads). Regular files are then narrowed down in stages, every stage works only on files which are still ambiguous after previous one: files are grouped by size (and hard links of the same inode are counted once - they don't take any space), then files of sizes shared with other files are hashed on first and last edge bytes, and only files with the same size and edge hash are hashed whole with large sequential reads. Files up to 2*edge bytes are hashed whole already in second stage. Hashing runs in threads of search, files are taken in device and inode order (roughly their order on disk). Hash is 128-bit, non-cryptographic (xxh64-like lanes with two finalizations) - it only groups candidates, it doesn't decide: before sets are reported, files of every group are compared byte by byte with the first file of the group, and group is split by what they really contain. Pairs left after edge stage aren't hashed whole at all - comparison reads them once anyway.
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "libfileseeker.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define prime1 0x9E3779B185EBCA87ULL
+#define prime2 0xC2B2AE3D27D4EB4FULL
+#define prime3 0x165667B19E3779F9ULL
+#define prime4 0x85EBCA77C2B2AE63ULL
+#define prime5 0x27D4EB2F165667C5ULL
+
+/** stages of hashing and comparison */
+#define dupes_stage_edge 0
+#define dupes_stage_full 1
+#define dupes_stage_verify 2
+
+/** max count of files compared with first file of group in one pass (all of them are open at once) */
+#define dupes_verify_files 64
+/** copy of candidate not known yet (verify stage) */
+#define dupes_unverified ((size_t) -1)
+
+/** @brief streaming hash - four lanes eat 32-byte stripes, the rest waits in tail. */
+typedef struct dupe_hasher {
+	uint64_t v[4];
+	uint64_t len;
+	unsigned char tail[32];
+	size_t tail_len;
+} dupe_hasher;
+
+/** @brief candidate file - hash is edge hash after second stage, full hash after third one (full is set if second one read whole file, pair if third one skips it - it's compared with its only twin). copy is position of file in its group which it's identical to (itself for the first one), set by comparison. */
+typedef struct dupe_file {
+	char* path;
+	uint64_t size;
+	uint64_t dev;
+	uint64_t ino;
+	uint64_t hash[2];
+	size_t copy;
+	int full;
+	int pair;
+	int error;
+} dupe_file;
+
+/** @brief group of candidates - first file and count in sorted candidates; set found by last stage with bytes it reclaims. */
+typedef struct dupe_set {
+	size_t first;
+	size_t count;
+	uint64_t reclaimable;
+} dupe_set;
+
+/** @brief state of one search - candidates and work of current stage (jobs or groups are taken by next index). */
+typedef struct dupes {
+	const fs_dupes_options* o;
+	dupe_file* files;
+	size_t count;
+	size_t cap;
+	uint64_t min_size;
+	size_t edge;
+	size_t block;
+	int threads;
+	int64_t deadline;
+	pthread_mutex_t lock;
+	volatile int stop;
+	int result;
+	dupe_file** jobs;
+	dupe_set* groups;
+	size_t job_count;
+	size_t next;
+	int stage;
+	fs_dupes_stats stats;
+} dupes;
+
+static inline uint64_t rotl(uint64_t x, int r){
+	return (x<<r) | (x>>(64-r));
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t input){
+	acc += input*prime2;
+	return rotl(acc, 31)*prime1;
+}
+
+static inline uint64_t hash_merge(uint64_t acc, uint64_t lane){
+	acc ^= hash_round(0, lane);
+	return acc*prime1+prime4;
+}
+
+static inline uint64_t read64(const unsigned char* p){
+	uint64_t x;
+	memcpy(&x, p, 8);
+	return x;
+}
+
+static void hasher_init(dupe_hasher* h){
+	h->v[0] = prime1+prime2;
+	h->v[1] = prime2;
+	h->v[2] = 0;
+	h->v[3] = -prime1;
+	h->len = 0;
+	h->tail_len = 0;
+}
+
+static void hasher_stripe(dupe_hasher* h, const unsigned char* p){
+	for(int i=0;i<4;i++)
+		h->v[i] = hash_round(h->v[i], read64(p+8*i));
+}
+
+static void hasher_update(dupe_hasher* h, const unsigned char* p, size_t n){
+	h->len += n;
+	if(h->tail_len){
+		size_t take = 32-h->tail_len < n ? 32-h->tail_len : n;
+		memcpy(h->tail+h->tail_len, p, take);
+		h->tail_len += take;
+		p += take;
+		n -= take;
+		if(h->tail_len<32)
+			return;
+		hasher_stripe(h, h->tail);
+		h->tail_len = 0;
+	}
+	for(;n>=32;p+=32,n-=32)
+		hasher_stripe(h, p);
+	memcpy(h->tail, p, n);
+	h->tail_len = n;
+}
+
+static uint64_t hasher_avalanche(uint64_t x){
+	x ^= x>>33;
+	x *= prime2;
+	x ^= x>>29;
+	x *= prime3;
+	return x ^ (x>>32);
+}
+
+/** @brief Fn finishes hash - two finalizations of lanes (in different order and seed) give 128 bits. */
+static void hasher_final(dupe_hasher* h, uint64_t out[2]){
+	uint64_t* v = h->v;
+	uint64_t a = rotl(v[0], 1)+rotl(v[1], 7)+rotl(v[2], 12)+rotl(v[3], 18);
+	uint64_t b = rotl(v[3], 1)+rotl(v[2], 7)+rotl(v[1], 12)+rotl(v[0], 18)+prime5;
+	for(int i=0;i<4;i++){
+		a = hash_merge(a, v[i]);
+		b = hash_merge(b, v[3-i]^prime3);
+	}
+	a += h->len;
+	b ^= h->len*prime4;
+	size_t i = 0;
+	for(;i+8<=h->tail_len;i+=8){
+		uint64_t k = read64(h->tail+i);
+		a = rotl(a^hash_round(0, k), 27)*prime1+prime4;
+		b = rotl(b^hash_round(prime5, k), 29)*prime2+prime3;
+	}
+	for(;i<h->tail_len;i++){
+		a = rotl(a^(h->tail[i]*prime5), 11)*prime1;
+		b = rotl(b^(h->tail[i]*prime1), 13)*prime3;
+	}
+	out[0] = hasher_avalanche(a);
+	out[1] = hasher_avalanche(b^out[0]);
+}
+
+static int64_t now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+/** @brief Fn ends search with result - first reason wins. */
+static void dupes_end(dupes* d, int result){
+	pthread_mutex_lock(&d->lock);
+	if(!d->stop){
+		d->result = result;
+		d->stop = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+}
+
+/** @brief Fn tells if search should go on - checked before every file and every block (token, time budget). */
+static int dupes_running(dupes* d){
+	if(d->stop)
+		return 0;
+	if(fs_cancel_requested(d->o->scan.cancel))
+		dupes_end(d, fs_scan_cancelled);
+	else if(d->deadline && now_ns()>=d->deadline)
+		dupes_end(d, fs_scan_deadline);
+	return !d->stop;
+}
+
+/** @brief callback of scan - keeps regular files big enough (callbacks of scan never run at once). */
+static int dupes_collect(const fs_scan_match* matches, size_t count, void* arg){
+	dupes* d = arg;
+	for(size_t i=0;i<count;i++){
+		const fs_scan_match* m = matches+i;
+		if(m->is_dir || !m->ino || m->size<d->min_size)
+			continue;
+		if(d->count==d->cap){
+			size_t cap = d->cap ? d->cap*2 : 1024;
+			dupe_file* tmp = realloc(d->files, sizeof(dupe_file)*cap);
+			if(!tmp){
+				dupes_end(d, fs_scan_error);
+				return 1;
+			}
+			d->files = tmp;
+			d->cap = cap;
+		}
+		dupe_file* f = d->files+d->count;
+		memset(f, 0, sizeof(*f));
+		if(!(f->path = strdup(m->path))){
+			dupes_end(d, fs_scan_error);
+			return 1;
+		}
+		f->size = m->size;
+		f->dev = m->dev;
+		f->ino = m->ino;
+		d->count++;
+	}
+	return 0;
+}
+
+static int compare_inode(const void* a, const void* b){
+	const dupe_file* x = a;
+	const dupe_file* y = b;
+	if(x->size!=y->size)
+		return (x->size>y->size) - (x->size<y->size);
+	if(x->dev!=y->dev)
+		return (x->dev>y->dev) - (x->dev<y->dev);
+	if(x->ino!=y->ino)
+		return (x->ino>y->ino) - (x->ino<y->ino);
+	return strcmp(x->path, y->path);
+}
+
+static int compare_hash(const void* a, const void* b){
+	const dupe_file* x = a;
+	const dupe_file* y = b;
+	if(x->size!=y->size)
+		return (x->size>y->size) - (x->size<y->size);
+	for(int i=0;i<2;i++)
+		if(x->hash[i]!=y->hash[i])
+			return (x->hash[i]>y->hash[i]) - (x->hash[i]<y->hash[i]);
+	return strcmp(x->path, y->path);
+}
+
+/** @brief jobs of stage go in device and inode order. */
+static int compare_job(const void* a, const void* b){
+	const dupe_file* x = *(dupe_file* const*) a;
+	const dupe_file* y = *(dupe_file* const*) b;
+	if(x->dev!=y->dev)
+		return (x->dev>y->dev) - (x->dev<y->dev);
+	return (x->ino>y->ino) - (x->ino<y->ino);
+}
+
+static int same_size(const dupe_file* x, const dupe_file* y){
+	return x->size==y->size;
+}
+
+static int same_hash(const dupe_file* x, const dupe_file* y){
+	return x->size==y->size && x->hash[0]==y->hash[0] && x->hash[1]==y->hash[1];
+}
+
+/** @brief files of group split by comparison - copies of the same file go together. */
+static int compare_copy(const void* a, const void* b){
+	const dupe_file* x = a;
+	const dupe_file* y = b;
+	int c = compare_hash(a, b);
+	if(!same_hash(x, y) || x->copy==y->copy)
+		return c;
+	return (x->copy>y->copy) - (x->copy<y->copy);
+}
+
+static int same_copy(const dupe_file* x, const dupe_file* y){
+	return same_hash(x, y) && x->copy==y->copy;
+}
+
+/** @brief Fn keeps only files of groups (runs of sorted files equal by same) with at least two members - the rest is not ambiguous anymore. Unreadable files are dropped.
+ * @return count of kept files.
+ */
+static size_t dupes_keep_groups(dupes* d, int (*same)(const dupe_file*, const dupe_file*)){
+	size_t kept = 0;
+	for(size_t i=0;i<d->count;){
+		if(d->files[i].error){
+			free(d->files[i++].path);
+			continue;
+		}
+		size_t j = i+1;
+		while(j<d->count && !d->files[j].error && same(d->files+i, d->files+j))
+			j++;
+		for(size_t k=i;k<j;k++){
+			if(j-i>1)
+				d->files[kept++] = d->files[k];
+			else
+				free(d->files[k].path);
+		}
+		i = j;
+	}
+	d->count = kept;
+	return kept;
+}
+
+/** @brief Fn drops hard links - every inode is counted once, under its first path (files are sorted by size, inode and path). */
+static void dupes_drop_links(dupes* d){
+	size_t kept = 0;
+	for(size_t i=0;i<d->count;i++){
+		dupe_file* f = d->files+i;
+		if(kept && f->size==d->files[kept-1].size && f->dev==d->files[kept-1].dev && f->ino==d->files[kept-1].ino){
+			free(f->path);
+			d->stats.hardlinks++;
+			continue;
+		}
+		d->files[kept++] = *f;
+	}
+	d->count = kept;
+}
+
+/** @brief Fn feeds length bytes of file from offset to hasher in reads of block size.
+ * @return 0 on success; 1 if file got shorter or read failed; -1 if search was stopped.
+ */
+static int hash_range(dupes* d, int fd, uint64_t offset, uint64_t length, unsigned char* buf, dupe_hasher* h){
+	while(length){
+		if(!dupes_running(d))
+			return -1;
+		size_t want = length<d->block ? length : d->block;
+		ssize_t got = pread(fd, buf, want, offset);
+		if(got<0 && errno==EINTR)
+			continue;
+		if(got<=0)
+			return 1;
+		hasher_update(h, buf, got);
+		__atomic_add_fetch(&d->stats.hashed_bytes, got, __ATOMIC_RELAXED);
+		offset += got;
+		length -= got;
+	}
+	return 0;
+}
+
+/** @brief Fn marks file which can't be read (or changed since scan) - it's dropped from its group. */
+static void file_error(dupes* d, dupe_file* f){
+	f->error = 1;
+	__atomic_add_fetch(&d->stats.errors, 1, __ATOMIC_RELAXED);
+}
+
+/** @brief Fn opens candidate and checks it's still the file scan found.
+ * @return descriptor; -1 if file can't be read or changed since scan (marked as error).
+ */
+static int open_file(dupes* d, dupe_file* f){
+	int fd = open(f->path, O_RDONLY | O_NOATIME | O_CLOEXEC);
+	if(fd<0 && errno==EPERM)
+		fd = open(f->path, O_RDONLY | O_CLOEXEC);
+	struct stat st;
+	if(fd<0 || fstat(fd, &st) || !S_ISREG(st.st_mode) || (uint64_t) st.st_size!=f->size || st.st_ino!=f->ino){
+		if(fd>=0)
+			close(fd);
+		file_error(d, f);
+		return -1;
+	}
+	return fd;
+}
+
+/** @brief Fn hashes file for current stage - head and tail (or whole small file) in edge stage, whole file in full stage. File which changed since scan is marked as error. */
+static void hash_file(dupes* d, dupe_file* f, unsigned char* buf){
+	int fd = open_file(d, f);
+	if(fd<0)
+		return;
+	dupe_hasher h;
+	hasher_init(&h);
+	int err;
+	if(d->stage==dupes_stage_edge && f->size<=2*d->edge){
+		err = hash_range(d, fd, 0, f->size, buf, &h);
+		f->full = 1;
+	}
+	else if(d->stage==dupes_stage_edge){
+		err = hash_range(d, fd, 0, d->edge, buf, &h);
+		if(!err)
+			err = hash_range(d, fd, f->size-d->edge, d->edge, buf, &h);
+	}
+	else{
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		err = hash_range(d, fd, 0, f->size, buf, &h);
+		/** whole file won't be read again - don't push out page cache of others */
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		__atomic_add_fetch(&d->stats.full_hashed, 1, __ATOMIC_RELAXED);
+	}
+	close(fd);
+	if(err>0)
+		file_error(d, f);
+	hasher_final(&h, f->hash);
+}
+
+/** @brief Fn reads length bytes of file from offset.
+ * @return 0 on success; 1 if file got shorter or read failed.
+ */
+static int read_block(dupes* d, int fd, unsigned char* buf, size_t length, uint64_t offset){
+	while(length){
+		ssize_t got = pread(fd, buf, length, offset);
+		if(got<0 && errno==EINTR)
+			continue;
+		if(got<=0)
+			return 1;
+		__atomic_add_fetch(&d->stats.hashed_bytes, got, __ATOMIC_RELAXED);
+		buf += got;
+		offset += got;
+		length -= got;
+	}
+	return 0;
+}
+
+/** @brief Fn compares files with first one block by block - files identical with it get its copy, the others stay unverified.
+ *
+ * @param first file all of them are compared with (its copy is set already)
+ * @param files the others (at most dupes_verify_files)
+ * @param buf two blocks
+ */
+static void compare_files(dupes* d, dupe_file* first, dupe_file** files, size_t count, unsigned char* buf){
+	int fds[dupes_verify_files];
+	int first_fd = open_file(d, first);
+	size_t live = 0;
+	for(size_t i=0;i<count;i++)
+		if((fds[i] = first_fd<0 ? -1 : open_file(d, files[i]))>=0)
+			live++;
+	if(first_fd>=0)
+		posix_fadvise(first_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	for(uint64_t offset=0;live && offset<first->size;offset+=d->block){
+		if(!dupes_running(d))
+			break;
+		size_t length = first->size-offset<d->block ? first->size-offset : d->block;
+		if(read_block(d, first_fd, buf, length, offset)){
+			file_error(d, first);
+			break;
+		}
+		for(size_t i=0;i<count;i++){
+			if(fds[i]<0)
+				continue;
+			int err = read_block(d, fds[i], buf+d->block, length, offset);
+			if(err || memcmp(buf, buf+d->block, length)){
+				if(err)
+					file_error(d, files[i]);
+				close(fds[i]);
+				fds[i] = -1;
+				live--;
+			}
+		}
+	}
+	for(size_t i=0;i<count;i++){
+		if(fds[i]<0)
+			continue;
+		if(!first->error && !d->stop)
+			files[i]->copy = first->copy;
+		posix_fadvise(fds[i], 0, 0, POSIX_FADV_DONTNEED);
+		close(fds[i]);
+	}
+	if(first_fd>=0){
+		posix_fadvise(first_fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(first_fd);
+	}
+}
+
+/** @brief Fn splits group by content - first unverified file is compared with all unverified ones after it (dupes_verify_files at once) and gets those identical with it, until every file has its copy. */
+static void verify_group(dupes* d, const dupe_set* g, unsigned char* buf){
+	dupe_file* files = d->files+g->first;
+	dupe_file* others[dupes_verify_files];
+	for(size_t i=0;i<g->count;i++)
+		files[i].copy = dupes_unverified;
+	for(size_t i=0;i<g->count && dupes_running(d);i++){
+		if(files[i].error || files[i].copy!=dupes_unverified)
+			continue;
+		files[i].copy = i;
+		for(size_t next=i+1;next<g->count && !files[i].error;){
+			size_t count = 0;
+			for(;next<g->count && count<dupes_verify_files;next++)
+				if(!files[next].error && files[next].copy==dupes_unverified)
+					others[count++] = files+next;
+			if(!count || !dupes_running(d))
+				break;
+			compare_files(d, files+i, others, count, buf);
+		}
+	}
+}
+
+/** @brief thread of stage - takes jobs (groups in verify stage) until there are none left. */
+static void* dupes_worker(void* arg){
+	dupes* d = arg;
+	unsigned char* buf = malloc(d->stage==dupes_stage_verify ? 2*d->block : d->block);
+	if(!buf){
+		dupes_end(d, fs_scan_error);
+		return NULL;
+	}
+	for(;;){
+		size_t i = __atomic_fetch_add(&d->next, 1, __ATOMIC_RELAXED);
+		if(i>=d->job_count || !dupes_running(d))
+			break;
+		if(d->stage==dupes_stage_verify)
+			verify_group(d, d->groups+i, buf);
+		else if(d->stage==dupes_stage_edge || (!d->jobs[i]->full && !d->jobs[i]->pair))
+			hash_file(d, d->jobs[i], buf);
+	}
+	free(buf);
+	return NULL;
+}
+
+/** @brief Fn runs jobs of stage in threads of search (caller's thread is one of them). */
+static void dupes_run(dupes* d, int stage){
+	d->next = 0;
+	d->stage = stage;
+	pthread_t ids[fs_scan_max_threads];
+	int started = 0;
+	sigset_t all, old;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	for(;started<d->threads-1;started++)
+		if(pthread_create(ids+started, NULL, dupes_worker, d))
+			break;
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	dupes_worker(d);
+	for(int i=0;i<started;i++)
+		pthread_join(ids[i], NULL);
+}
+
+/** @brief Fn runs hashing stage over all candidates.
+ * @return 0 on success; 1 if search was stopped.
+ */
+static int dupes_stage(dupes* d, int stage){
+	if(!(d->jobs = malloc(sizeof(dupe_file*)*(d->count ? d->count : 1)))){
+		dupes_end(d, fs_scan_error);
+		return 1;
+	}
+	for(size_t i=0;i<d->count;i++)
+		d->jobs[i] = d->files+i;
+	qsort(d->jobs, d->count, sizeof(dupe_file*), compare_job);
+	d->job_count = d->count;
+	dupes_run(d, stage);
+	free(d->jobs);
+	d->jobs = NULL;
+	return d->stop;
+}
+
+/** @brief Fn finds groups of sorted candidates (runs equal by same).
+ * @return groups (count in d->job_count); NULL on error.
+ */
+static dupe_set* dupes_groups(dupes* d, int (*same)(const dupe_file*, const dupe_file*)){
+	dupe_set* groups = malloc(sizeof(dupe_set)*(d->count ? d->count : 1));
+	d->job_count = 0;
+	for(size_t i=0;groups && i<d->count;){
+		size_t j = i+1;
+		while(j<d->count && same(d->files+i, d->files+j))
+			j++;
+		groups[d->job_count].first = i;
+		groups[d->job_count].count = j-i;
+		groups[d->job_count++].reclaimable = d->files[i].size*(j-i-1);
+		i = j;
+	}
+	return groups;
+}
+
+/** @brief Fn marks files of edge groups with just two members - full hash wouldn't tell more than comparison, which reads them anyway. */
+static void dupes_mark_pairs(dupes* d){
+	for(size_t i=0;i+1<d->count;){
+		size_t j = i+1;
+		while(j<d->count && same_hash(d->files+i, d->files+j))
+			j++;
+		if(j-i==2 && !d->files[i].full)
+			d->files[i].pair = d->files[i+1].pair = 1;
+		i = j;
+	}
+}
+
+/** @brief Fn compares files of every group byte by byte (groups in threads of search) and splits groups by content.
+ * @return 0 on success; 1 if search was stopped.
+ */
+static int dupes_verify(dupes* d){
+	if(!(d->groups = dupes_groups(d, same_hash))){
+		dupes_end(d, fs_scan_error);
+		return 1;
+	}
+	dupes_run(d, dupes_stage_verify);
+	free(d->groups);
+	d->groups = NULL;
+	return d->stop;
+}
+
+static int compare_set(const void* a, const void* b){
+	const dupe_set* x = a;
+	const dupe_set* y = b;
+	if(x->reclaimable!=y->reclaimable)
+		return (x->reclaimable<y->reclaimable) - (x->reclaimable>y->reclaimable);
+	return (x->first>y->first) - (x->first<y->first);
+}
+
+/** @brief Fn hands sets to callback, the ones reclaiming most first. */
+static void dupes_report(dupes* d){
+	dupe_set* sets = dupes_groups(d, same_copy);
+	size_t count = d->job_count;
+	const char** paths = malloc(sizeof(char*)*(d->count ? d->count : 1));
+	if(!sets || !paths){
+		free(sets);
+		free(paths);
+		dupes_end(d, fs_scan_error);
+		return;
+	}
+	for(size_t i=0;i<count;i++){
+		d->stats.duplicates += sets[i].count-1;
+		d->stats.reclaimable += sets[i].reclaimable;
+	}
+	d->stats.sets = count;
+	qsort(sets, count, sizeof(dupe_set), compare_set);
+	for(size_t i=0;i<count;i++){
+		for(size_t k=0;k<sets[i].count;k++)
+			paths[k] = d->files[sets[i].first+k].path;
+		fs_dupes_set set = {d->files[sets[i].first].size, paths, sets[i].count};
+		if(d->o->callback(&set, d->o->arg)){
+			dupes_end(d, fs_scan_cancelled);
+			break;
+		}
+	}
+	free(sets);
+	free(paths);
+}
+
+/** @brief Fn fills options with defaults of scan (fs_scan_options_init), all files of at least 1 byte, 4 KiB edges, 1 MiB reads. */
+void fs_dupes_options_init(fs_dupes_options* options){
+	memset(options, 0, sizeof(*options));
+	fs_scan_options_init(&options->scan);
+	options->min_size = 1;
+	options->edge = fs_dupes_default_edge;
+	options->block = fs_dupes_default_block;
+}
+
+/** @brief Fn finds sets of files with identical content under root and returns when all of them are delivered to callback.
+ *
+ * Sets are reported only after all stages, so search which was cancelled or ran out of time reports none. Patterns with limits which get satisfied end only scan - candidates found so far are still hashed.
+ * @param options what to look for
+ * @param stats counters of search (can be NULL)
+ * @return result (fs_scan_complete, fs_scan_cancelled, fs_scan_deadline); fs_scan_error with errno set (EINVAL - invalid options, ENOMEM).
+ */
+int fs_dupes(const fs_dupes_options* options, fs_dupes_stats* stats){
+	static const char* const all[] = {"*"};
+	if(!options || !options->callback){
+		errno = EINVAL;
+		return fs_scan_error;
+	}
+	dupes d;
+	memset(&d, 0, sizeof(d));
+	d.o = options;
+	d.min_size = options->min_size;
+	d.edge = options->edge ? options->edge : fs_dupes_default_edge;
+	d.block = options->block ? options->block : fs_dupes_default_block;
+	if(d.block<d.edge)
+		d.block = d.edge;
+	d.threads = options->threads>0 ? options->threads : options->scan.threads;
+	if(d.threads<1)
+		d.threads = 1;
+	if(d.threads>fs_scan_max_threads)
+		d.threads = fs_scan_max_threads;
+	d.deadline = options->scan.deadline_ms>0 ? now_ns()+(int64_t) options->scan.deadline_ms*1000000 : 0;
+	pthread_mutex_init(&d.lock, NULL);
+
+	fs_scan_options o = options->scan;
+	o.stat = 1;
+	o.callback = dupes_collect;
+	o.arg = &d;
+	if(!o.pattern_count){
+		o.patterns = all;
+		o.pattern_count = 1;
+		o.matcher = "glob";
+	}
+	int result = fs_scan(&o, &d.stats.scan);
+	int err = errno;
+	if(d.stop)
+		result = d.result;
+	if(result==fs_scan_satisfied)
+		result = fs_scan_complete;
+	d.stats.files = d.count;
+
+	if(result==fs_scan_complete){
+		qsort(d.files, d.count, sizeof(dupe_file), compare_inode);
+		dupes_drop_links(&d);
+		d.stats.size_candidates = dupes_keep_groups(&d, same_size);
+		if(!dupes_stage(&d, dupes_stage_edge)){
+			qsort(d.files, d.count, sizeof(dupe_file), compare_hash);
+			d.stats.edge_candidates = dupes_keep_groups(&d, same_hash);
+			dupes_mark_pairs(&d);
+			if(!dupes_stage(&d, dupes_stage_full)){
+				qsort(d.files, d.count, sizeof(dupe_file), compare_hash);
+				dupes_keep_groups(&d, same_hash);
+				/** hash only groups candidates - content decides */
+				if(!dupes_verify(&d)){
+					qsort(d.files, d.count, sizeof(dupe_file), compare_copy);
+					dupes_keep_groups(&d, same_copy);
+					dupes_report(&d);
+				}
+			}
+		}
+		result = d.stop ? d.result : fs_scan_complete;
+	}
+
+	if(stats)
+		*stats = d.stats;
+	for(size_t i=0;i<d.count;i++)
+		free(d.files[i].path);
+	free(d.files);
+	pthread_mutex_destroy(&d.lock);
+	if(result==fs_scan_error)
+		errno = d.stop ? ENOMEM : err;
+	return result;
+}
@@ -0,0 +1,400 @@
+/** @file libfileseeker.c
+ *  @brief Embeddable scanning engine - reentrant search with batched callback, cancellation and own threads.
+ *
+ * Library does what child of daemon does in one scan - every directory is listed, matched and ordered by the same traversal core (walk.c) over traversal backend (backend.c, replay.c) and compiled pattern set (matcher.c) - but all its state lives in one scan, so many scans can run at once in one process, and it doesn't touch signals, syslog, getopt or shared memory. Directories waiting for visit are kept on stack shared by threads of scan: every thread takes directory, lists it and pushes its subdirectories (in readdir, inode or extent order). Matches are collected per thread and delivered to callback in batches; patterns with limit ("pattern/N", "pattern/exists") are counted by core under lock, so no pattern is reported more times than its limit.
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "libfileseeker.h"
+#include "../src/walk.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/** @brief cancellation token. */
+struct fs_cancel {
+	int requested;
+};
+
+/** @brief matches of one thread waiting for callback - paths are kept as offsets into one buffer until delivery. */
+typedef struct scan_batch {
+	fs_scan_match* matches;
+	size_t* offsets;
+	size_t count;
+	char* paths;
+	size_t len;
+	size_t cap;
+} scan_batch;
+
+/** @brief state of one scan.
+*
+* walk is traversal core with backend and patterns of scan (it counts patterns under its own lock). lock guards stack, busy (threads which are listing directory) and result; deliver serializes callbacks. stop is read without lock in hot loop - it's only ever set.
+*/
+typedef struct scan {
+	const fs_scan_options* o;
+	walk_ctx walk;
+	size_t batch;
+	int64_t deadline;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_mutex_t deliver;
+	char** stack;
+	size_t stack_count;
+	size_t stack_cap;
+	int busy;
+	volatile int stop;
+	int result;
+	fs_scan_stats stats;
+} scan;
+
+static int64_t now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+/** @brief Fn creates cancellation token.
+ * @return token; NULL on error.
+ */
+fs_cancel* fs_cancel_create(void){
+	return calloc(1, sizeof(fs_cancel));
+}
+
+/** @brief Fn requests cancellation - scans using token end at next directory (async-signal-safe). */
+void fs_cancel_request(fs_cancel* cancel){
+	__atomic_store_n(&cancel->requested, 1, __ATOMIC_RELEASE);
+}
+
+/** @brief Fn tells if cancellation was requested. */
+int fs_cancel_requested(const fs_cancel* cancel){
+	return cancel && __atomic_load_n(&cancel->requested, __ATOMIC_ACQUIRE);
+}
+
+/** @brief Fn makes token usable for next scan. */
+void fs_cancel_reset(fs_cancel* cancel){
+	__atomic_store_n(&cancel->requested, 0, __ATOMIC_RELEASE);
+}
+
+void fs_cancel_free(fs_cancel* cancel){
+	free(cancel);
+}
+
+/** @brief Fn fills options with defaults - root "/", posix backend, strstr matcher, readdir order, one thread. */
+void fs_scan_options_init(fs_scan_options* options){
+	memset(options, 0, sizeof(*options));
+	options->root = "/";
+	options->backend = "posix";
+	options->matcher = "strstr";
+	options->order = "readdir";
+	options->threads = 1;
+	options->batch = fs_scan_default_batch;
+}
+
+/** @brief Fn names result of fs_scan. */
+const char* fs_scan_result_name(int result){
+	switch (result) {
+		case fs_scan_complete:
+			return "complete";
+		case fs_scan_satisfied:
+			return "satisfied";
+		case fs_scan_cancelled:
+			return "cancelled";
+		case fs_scan_deadline:
+			return "deadline";
+		default:
+			return "error";
+	}
+}
+
+/** @brief Fn ends scan with result (lock held) - first reason wins. */
+static void scan_end(scan* s, int result){
+	if(!s->stop){
+		s->result = result;
+		s->stop = 1;
+		pthread_cond_broadcast(&s->wake);
+	}
+}
+
+/** @brief Fn tells if scan should go on - checked once per directory (token, time budget). */
+static int scan_running(scan* s){
+	if(s->stop)
+		return 0;
+	int reason = -1;
+	if(fs_cancel_requested(s->o->cancel))
+		reason = fs_scan_cancelled;
+	else if(s->deadline && now_ns()>=s->deadline)
+		reason = fs_scan_deadline;
+	if(reason<0)
+		return 1;
+	pthread_mutex_lock(&s->lock);
+	scan_end(s, reason);
+	pthread_mutex_unlock(&s->lock);
+	return 0;
+}
+
+/** @brief Fn hands batch of thread to callback; callback asking for cancel ends scan. */
+static void batch_flush(scan* s, scan_batch* b){
+	if(!b->count)
+		return;
+	for(size_t i=0;i<b->count;i++)
+		b->matches[i].path = b->paths+b->offsets[i];
+	pthread_mutex_lock(&s->deliver);
+	int cancel = s->o->callback(b->matches, b->count, s->o->arg);
+	pthread_mutex_unlock(&s->deliver);
+	b->count = 0;
+	b->len = 0;
+	if(cancel){
+		pthread_mutex_lock(&s->lock);
+		scan_end(s, fs_scan_cancelled);
+		pthread_mutex_unlock(&s->lock);
+	}
+}
+
+/** @brief Fn adds match to batch of thread, full batch is handed to callback.
+ * @return 0 on success; -1 if there's no memory for path (match is lost, so scan ends with fs_scan_error).
+ */
+static int batch_add(scan* s, scan_batch* b, const char* path, int pattern, int is_dir){
+	size_t len = strlen(path)+1;
+	if(b->len+len>b->cap){
+		size_t cap = b->cap ? b->cap : 4096;
+		while(cap<b->len+len)
+			cap *= 2;
+		char* tmp = realloc(b->paths, cap);
+		if(!tmp){
+			pthread_mutex_lock(&s->lock);
+			scan_end(s, fs_scan_error);
+			pthread_mutex_unlock(&s->lock);
+			return -1;
+		}
+		b->paths = tmp;
+		b->cap = cap;
+	}
+	memcpy(b->paths+b->len, path, len);
+	b->offsets[b->count] = b->len;
+	fs_scan_match* m = b->matches+b->count++;
+	m->pattern = pattern;
+	m->is_dir = is_dir;
+	m->size = m->dev = m->ino = 0;
+	struct stat st;
+	if(s->o->stat && !lstat(path, &st)){
+		m->size = st.st_size;
+		m->dev = st.st_dev;
+		m->ino = st.st_ino;
+	}
+	b->len += len;
+	if(b->count==s->batch)
+		batch_flush(s, b);
+	return 0;
+}
+
+/** @brief hook - listing ends when scan is stopped. */
+static int scan_stopped(void* arg){
+	return ((scan*) arg)->stop;
+}
+
+/** @brief hook - match goes to batch of thread (dir of walk_list). */
+static void scan_match(void* arg, void* dir, const char* path, int pattern, int is_dir){
+	scan* s = arg;
+	if(!batch_add(s, dir, path, pattern, is_dir))
+		__atomic_add_fetch(&s->stats.matches, 1, __ATOMIC_RELAXED);
+}
+
+/** @brief hook - all patterns reached their limits. */
+static void scan_satisfied(void* arg){
+	scan* s = arg;
+	pthread_mutex_lock(&s->lock);
+	scan_end(s, fs_scan_satisfied);
+	pthread_mutex_unlock(&s->lock);
+}
+
+/** @brief Fn lists one directory (entries are matched by core) and pushes its subdirectories, so the first one is taken first; subdirectory that can't be collected or pushed (no memory) ends scan with fs_scan_error - it's never reported complete without it. */
+static void scan_dir(scan* s, scan_batch* b, const char* root_path){
+	walk_listing l = {0};
+	if(walk_list(&s->walk, root_path, b, &l)!=walk_listed){
+		__atomic_add_fetch(&s->stats.skipped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	__atomic_add_fetch(&s->stats.dirs, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&s->stats.entries, l.entries, __ATOMIC_RELAXED);
+	walk_order(&s->walk, root_path, &l);
+
+	char path[walk_path_len];
+	pthread_mutex_lock(&s->lock);
+	if(l.lost)
+		scan_end(s, fs_scan_error);
+	if(!s->stop && s->stack_count+l.count>s->stack_cap){
+		size_t cap = s->stack_cap ? s->stack_cap : 256;
+		while(cap<s->stack_count+l.count)
+			cap *= 2;
+		char** tmp = realloc(s->stack, sizeof(char*)*cap);
+		if(tmp){
+			s->stack = tmp;
+			s->stack_cap = cap;
+		} else
+			scan_end(s, fs_scan_error);
+	}
+	for(uint32_t i=l.count;i-->0 && !s->stop;){
+		walk_path(path, root_path, l.subdirs[i].name);
+		char* copy = strdup(path);
+		if(copy)
+			s->stack[s->stack_count++] = copy;
+		else
+			scan_end(s, fs_scan_error);
+	}
+	if(l.count)
+		pthread_cond_broadcast(&s->wake);
+	pthread_mutex_unlock(&s->lock);
+	walk_listing_free(&l);
+}
+
+/** @brief thread of scan - takes directories until stack is empty and no thread can push more. */
+static void* scan_worker(void* arg){
+	scan* s = arg;
+	scan_batch b = {0};
+	b.matches = malloc(sizeof(fs_scan_match)*s->batch);
+	b.offsets = malloc(sizeof(size_t)*s->batch);
+	if(!b.matches || !b.offsets){
+		pthread_mutex_lock(&s->lock);
+		scan_end(s, fs_scan_error);
+		pthread_mutex_unlock(&s->lock);
+	}
+	pthread_mutex_lock(&s->lock);
+	for(;;){
+		while(!s->stop && !s->stack_count && s->busy)
+			pthread_cond_wait(&s->wake, &s->lock);
+		if(s->stop || !s->stack_count)
+			break;
+		char* path = s->stack[--s->stack_count];
+		s->busy++;
+		pthread_mutex_unlock(&s->lock);
+		if(scan_running(s))
+			scan_dir(s, &b, path);
+		free(path);
+		pthread_mutex_lock(&s->lock);
+		if(!--s->busy && !s->stack_count)
+			pthread_cond_broadcast(&s->wake);
+	}
+	pthread_mutex_unlock(&s->lock);
+	if(b.matches && b.offsets)
+		batch_flush(s, &b);
+	free(b.matches);
+	free(b.offsets);
+	free(b.paths);
+	return NULL;
+}
+
+static void scan_free(scan* s){
+	fs_backend* b = s->walk.backend;
+	walk_free(&s->walk);
+	for(size_t i=0;i<s->stack_count;i++)
+		free(s->stack[i]);
+	free(s->stack);
+	if(b)
+		b->destroy(b);
+}
+
+/** @brief Fn compiles patterns and opens backend of scan.
+ *
+ * Limits are cut off patterns by limit_split, the same way daemon does it (config.c) - but invalid one is an error here, not default.
+ * @return 0 on success; errno value on error.
+ */
+static int scan_prepare(scan* s, const fs_scan_options* o){
+	s->o = o;
+	if(!o->root || !o->callback || !o->patterns || o->pattern_count<=0)
+		return EINVAL;
+	int kind = matcher_parse(o->matcher ? o->matcher : "strstr");
+	int order = order_parse(o->order ? o->order : "readdir");
+	if(kind<0 || order<0 || order==order_hot)
+		return EINVAL;
+	s->batch = o->batch ? o->batch : fs_scan_default_batch;
+	s->deadline = o->deadline_ms>0 ? now_ns()+(int64_t) o->deadline_ms*1000000 : 0;
+	char** words = calloc(o->pattern_count, sizeof(char*));
+	int* limits = calloc(o->pattern_count, sizeof(int));
+	int err = (words && limits) ? 0 : ENOMEM;
+	for(int i=0;i<o->pattern_count && !err;i++){
+		if(!o->patterns[i])
+			err = EINVAL;
+		else if(!(words[i] = strdup(o->patterns[i])))
+			err = ENOMEM;
+		else if(limit_split(words[i], limits+i) || !*words[i])
+			err = EINVAL;
+	}
+	fs_backend* b = NULL;
+	if(!err && !(b = backend_create(o->backend ? o->backend : "posix")))
+		err = EINVAL;
+	walk_hooks hooks = {scan_stopped, NULL, scan_match, scan_satisfied, NULL, s};
+	/** backend belongs to traversal from now on - scan_free destroys it */
+	if(!err)
+		err = walk_init(&s->walk, b, kind, order, words, limits, o->pattern_count, &hooks);
+	else if(b)
+		b->destroy(b);
+	for(int i=0;words && i<o->pattern_count;i++)
+		free(words[i]);
+	free(words);
+	free(limits);
+	if(err)
+		return err;
+	if(!(s->stack = malloc(sizeof(char*)*256)) || !(s->stack[0] = strdup(o->root)))
+		return ENOMEM;
+	s->stack_cap = 256;
+	s->stack_count = 1;
+	return 0;
+}
+
+/** @brief Fn runs one scan and returns when it ends - all matches are delivered to callback by then.
+ *
+ * Caller's thread takes part in scan, options->threads-1 more threads are started (with all signals blocked) and joined before return. Scan ends by itself (fs_scan_complete), when all patterns reached their limits (fs_scan_satisfied), when token is cancelled or callback returns nonzero (fs_scan_cancelled) or when deadline passes (fs_scan_deadline).
+ * @param options what to scan
+ * @param stats counters of scan (can be NULL)
+ * @return result of scan; fs_scan_error with errno set (EINVAL - invalid options, ENOMEM).
+ */
+int fs_scan(const fs_scan_options* options, fs_scan_stats* stats){
+	scan s;
+	memset(&s, 0, sizeof(s));
+	int err = scan_prepare(&s, options);
+	if(err){
+		scan_free(&s);
+		errno = err;
+		return fs_scan_error;
+	}
+	pthread_mutex_init(&s.lock, NULL);
+	pthread_mutex_init(&s.deliver, NULL);
+	pthread_cond_init(&s.wake, NULL);
+	s.result = fs_scan_complete;
+
+	int threads = options->threads>0 ? options->threads : 1;
+	if(threads>fs_scan_max_threads)
+		threads = fs_scan_max_threads;
+	pthread_t* ids = malloc(sizeof(pthread_t)*threads);
+	int started = 0;
+	if(ids){
+		sigset_t all, old;
+		sigfillset(&all);
+		pthread_sigmask(SIG_SETMASK, &all, &old);
+		for(;started<threads-1;started++)
+			if(pthread_create(ids+started, NULL, scan_worker, &s))
+				break;
+		pthread_sigmask(SIG_SETMASK, &old, NULL);
+	}
+	scan_worker(&s);
+	for(int i=0;i<started;i++)
+		pthread_join(ids[i], NULL);
+	free(ids);
+
+	if(stats)
+		*stats = s.stats;
+	int result = s.result;
+	pthread_mutex_destroy(&s.lock);
+	pthread_mutex_destroy(&s.deliver);
+	pthread_cond_destroy(&s.wake);
+	scan_free(&s);
+	if(result==fs_scan_error)
+		errno = ENOMEM;
+	return result;
+}
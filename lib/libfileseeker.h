@@ -0,0 +1,128 @@
+#include <stddef.h>
+#include <stdint.h>
+#ifndef LIBFILESEEKER
+#define LIBFILESEEKER
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief API of library is the only thing shared object exports. */
+#define fs_api __attribute__((visibility("default")))
+
+#define fs_scan_version 2
+
+/** results of fs_scan */
+#define fs_scan_complete 0
+#define fs_scan_satisfied 1
+#define fs_scan_cancelled 2
+#define fs_scan_deadline 3
+#define fs_scan_error -1
+
+/** defaults of fs_scan_options */
+#define fs_scan_default_batch 64
+#define fs_scan_max_threads 256
+
+/** @brief one found file or directory; path is valid only during callback. size, dev and ino are filled only if options asked for stat (0 if it failed). */
+typedef struct fs_scan_match {
+	const char* path;
+	int pattern;
+	int is_dir;
+	uint64_t size;
+	uint64_t dev;
+	uint64_t ino;
+} fs_scan_match;
+
+/** @brief callback gets batch of matches; it's never called by two threads at once. Nonzero return value cancels scan. */
+typedef int (*fs_scan_callback)(const fs_scan_match* matches, size_t count, void* arg);
+
+/** @brief cancellation token - can be shared by many scans and requested from any thread or signal handler. */
+typedef struct fs_cancel fs_cancel;
+
+/** @brief what to scan and how (fs_scan_options_init fills defaults).
+*
+* patterns are substrings of names (globs with matcher "glob") and can end with match limit like in daemon: "pattern/N" - pattern is satisfied after N matches, "pattern/exists" - after first one; scan ends early when all patterns are satisfied. backend is posix, getdents or replay:file, matcher strstr, ac, simd or glob, order readdir, inode or extent. threads read directories in parallel (caller's thread is one of them); batch is max count of matches in one callback; deadline_ms limits scan time (0 - no limit); stat makes threads of scan lstat every match (size, device and inode in fs_scan_match).
+*/
+typedef struct fs_scan_options {
+	const char* root;
+	const char* const* patterns;
+	int pattern_count;
+	const char* backend;
+	const char* matcher;
+	const char* order;
+	int threads;
+	size_t batch;
+	int deadline_ms;
+	int stat;
+	fs_scan_callback callback;
+	void* arg;
+	fs_cancel* cancel;
+} fs_scan_options;
+
+/** @brief counters of finished scan. */
+typedef struct fs_scan_stats {
+	uint64_t dirs;
+	uint64_t entries;
+	uint64_t skipped;
+	uint64_t matches;
+} fs_scan_stats;
+
+/** defaults of fs_dupes_options */
+#define fs_dupes_default_edge 4096
+#define fs_dupes_default_block (1<<20)
+
+/** @brief one set of identical files (sorted by path); paths are valid only during callback. */
+typedef struct fs_dupes_set {
+	uint64_t size;
+	const char* const* paths;
+	size_t count;
+} fs_dupes_set;
+
+/** @brief callback gets sets one by one, the ones reclaiming most bytes first. Nonzero return value cancels search. */
+typedef int (*fs_dupes_callback)(const fs_dupes_set* set, void* arg);
+
+/** @brief what duplicates to look for (fs_dupes_options_init fills defaults).
+*
+* scan picks candidates - root, backend, order, threads, deadline_ms and cancel work like in fs_scan, patterns (with matcher) narrow files down (none - all regular files); its callback, arg and stat are ignored. Files smaller than min_size are skipped. edge is count of bytes hashed at head and at tail of file in second stage, block is size of sequential reads of full hash; threads hash files in parallel (0 - as many as scan.threads).
+*/
+typedef struct fs_dupes_options {
+	fs_scan_options scan;
+	uint64_t min_size;
+	size_t edge;
+	size_t block;
+	int threads;
+	fs_dupes_callback callback;
+	void* arg;
+} fs_dupes_options;
+
+/** @brief counters of finished search - candidates left after every stage, bytes read by hashing and comparison and what duplicates take. */
+typedef struct fs_dupes_stats {
+	fs_scan_stats scan;
+	uint64_t files;
+	uint64_t hardlinks;
+	uint64_t size_candidates;
+	uint64_t edge_candidates;
+	uint64_t full_hashed;
+	uint64_t hashed_bytes;
+	uint64_t errors;
+	uint64_t sets;
+	uint64_t duplicates;
+	uint64_t reclaimable;
+} fs_dupes_stats;
+
+fs_api void fs_scan_options_init(fs_scan_options* options);
+fs_api int fs_scan(const fs_scan_options* options, fs_scan_stats* stats);
+fs_api const char* fs_scan_result_name(int result);
+fs_api fs_cancel* fs_cancel_create(void);
+fs_api void fs_cancel_request(fs_cancel* cancel);
+fs_api int fs_cancel_requested(const fs_cancel* cancel);
+fs_api void fs_cancel_reset(fs_cancel* cancel);
+fs_api void fs_cancel_free(fs_cancel* cancel);
+fs_api void fs_dupes_options_init(fs_dupes_options* options);
+fs_api int fs_dupes(const fs_dupes_options* options, fs_dupes_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,214 @@
+/** @file backend.c
+ *  @brief Traversal backends - POSIX opendir/readdir and raw getdents64.
+ *
+ * Search doesn't call opendir/readdir directly - it goes through fs_backend chosen with -b option. posix backend is the classic access/opendir/readdir path (entries with unknown d_type are resolved with lstat). getdents backend reads directories with getdents64 syscall into one 32 KiB buffer, without DIR* allocation and libc locking. Both kernel backends find where directory lies on disk with FIEMAP (for -o extent). replay backend (replay.c) serves recorded tree from memory, so search logic can be benchmarked without disks and kernel caches.
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "fileseeker.h"
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+
+/** @brief Fn creates backend from specification.
+ * @return backend; NULL on error (unknown name, unreadable replay file).
+ */
+fs_backend* backend_create(const char* spec){
+	if(!strcmp(spec, "posix"))
+		return backend_posix();
+	if(!strcmp(spec, "getdents"))
+		return backend_getdents();
+	if(!strncmp(spec, "replay:", 7))
+		return backend_replay(spec+7);
+	return NULL;
+}
+
+/** @brief access() is the same for both kernel backends. */
+static int kernel_access(fs_backend* b, const char* path){
+	return access(path, R_OK);
+}
+
+/** @brief mtime of directory is the same for both kernel backends too. */
+static int64_t kernel_mtime(fs_backend* b, const char* path){
+	struct stat st;
+	if(stat(path, &st))
+		return 0;
+	return (int64_t) st.st_mtim.tv_sec*1000000000+st.st_mtim.tv_nsec;
+}
+
+/** @brief first extent of directory from FIEMAP; filesystems without it (tmpfs, proc...) say 0. */
+static uint64_t kernel_location(fs_backend* b, const char* path){
+	int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(fd<0)
+		return 0;
+	struct {
+		struct fiemap map;
+		struct fiemap_extent extent;
+	} m;
+	memset(&m, 0, sizeof(m));
+	m.map.fm_length = FIEMAP_MAX_OFFSET;
+	m.map.fm_extent_count = 1;
+	uint64_t location = 0;
+	if(!ioctl(fd, FS_IOC_FIEMAP, &m) && m.map.fm_mapped_extents)
+		location = m.extent.fe_physical;
+	close(fd);
+	return location;
+}
+
+static void simple_destroy(fs_backend* b){
+	free(b);
+}
+
+/** @brief posix backend directory - DIR* and path for lstat of DT_UNKNOWN entries. */
+struct posix_dir {
+	DIR* dir;
+	const char* path;
+	char buf[MAX_PATH_LEN];
+};
+
+static fs_dir* posix_open(fs_backend* b, const char* path){
+	struct posix_dir* d = malloc(sizeof(struct posix_dir));
+	if(!d)
+		return NULL;
+	if(!(d->dir = opendir(path))){
+		free(d);
+		return NULL;
+	}
+	d->path = path;
+	return (fs_dir*) d;
+}
+
+/** @brief maps d_type to fs_type. */
+static int dtype_to_type(unsigned char d_type){
+	switch (d_type) {
+		case DT_DIR:
+			return fs_type_dir;
+		case DT_REG:
+			return fs_type_reg;
+		default:
+			return fs_type_other;
+	}
+}
+
+/** @brief resolves type of entry when filesystem doesn't fill d_type. */
+static int lstat_type(const char* dir, const char* name, char* buf){
+	struct stat st;
+	snprintf(buf, MAX_PATH_LEN, "%s/%s", dir, name);
+	if(lstat(buf, &st))
+		return fs_type_other;
+	if(S_ISDIR(st.st_mode))
+		return fs_type_dir;
+	if(S_ISREG(st.st_mode))
+		return fs_type_reg;
+	return fs_type_other;
+}
+
+static int posix_read(fs_backend* b, fs_dir* dir, fs_entry* entry){
+	struct posix_dir* d = (struct posix_dir*) dir;
+	struct dirent* e = readdir(d->dir);
+	if(!e)
+		return 0;
+	entry->name = e->d_name;
+	entry->ino = e->d_ino;
+	entry->type = (e->d_type==DT_UNKNOWN) ? lstat_type(d->path, e->d_name, d->buf) : dtype_to_type(e->d_type);
+	return 1;
+}
+
+static void posix_close(fs_backend* b, fs_dir* dir){
+	struct posix_dir* d = (struct posix_dir*) dir;
+	closedir(d->dir);
+	free(d);
+}
+
+/** @brief Fn creates posix (opendir/readdir) backend. */
+fs_backend* backend_posix(){
+	fs_backend* b = calloc(1, sizeof(fs_backend));
+	if(!b)
+		return NULL;
+	b->name = "posix";
+	b->access = kernel_access;
+	b->open_dir = posix_open;
+	b->read_dir = posix_read;
+	b->close_dir = posix_close;
+	b->mtime = kernel_mtime;
+	b->location = kernel_location;
+	b->destroy = simple_destroy;
+	return b;
+}
+
+/** @brief record returned by getdents64. */
+struct linux_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+#define getdents_buf_len 32768
+
+/** @brief getdents backend directory - fd and buffer of raw records. */
+struct getdents_dir {
+	int fd;
+	int pos;
+	int len;
+	const char* path;
+	char name_buf[MAX_PATH_LEN];
+	char buf[getdents_buf_len] __attribute__((aligned(8)));
+};
+
+static fs_dir* getdents_open(fs_backend* b, const char* path){
+	struct getdents_dir* d = malloc(sizeof(struct getdents_dir));
+	if(!d)
+		return NULL;
+	if((d->fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC))<0){
+		free(d);
+		return NULL;
+	}
+	d->pos = d->len = 0;
+	d->path = path;
+	return (fs_dir*) d;
+}
+
+static int getdents_read(fs_backend* b, fs_dir* dir, fs_entry* entry){
+	struct getdents_dir* d = (struct getdents_dir*) dir;
+	if(d->pos>=d->len){
+		long n = syscall(SYS_getdents64, d->fd, d->buf, getdents_buf_len);
+		if(n<0)
+			return -1;
+		if(n==0)
+			return 0;
+		d->len = n;
+		d->pos = 0;
+	}
+	struct linux_dirent64* e = (struct linux_dirent64*) (d->buf+d->pos);
+	d->pos += e->d_reclen;
+	entry->name = e->d_name;
+	entry->ino = e->d_ino;
+	entry->type = (e->d_type==DT_UNKNOWN) ? lstat_type(d->path, e->d_name, d->name_buf) : dtype_to_type(e->d_type);
+	return 1;
+}
+
+static void getdents_close(fs_backend* b, fs_dir* dir){
+	struct getdents_dir* d = (struct getdents_dir*) dir;
+	close(d->fd);
+	free(d);
+}
+
+/** @brief Fn creates getdents64 backend. */
+fs_backend* backend_getdents(){
+	fs_backend* b = calloc(1, sizeof(fs_backend));
+	if(!b)
+		return NULL;
+	b->name = "getdents";
+	b->access = kernel_access;
+	b->open_dir = getdents_open;
+	b->read_dir = getdents_read;
+	b->close_dir = getdents_close;
+	b->mtime = kernel_mtime;
+	b->location = kernel_location;
+	b->destroy = simple_destroy;
+	return b;
+}
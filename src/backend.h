@@ -0,0 +1,59 @@
+#include <stdint.h>
+#include "pathstore.h"
+#ifndef FILE_SEEKER_BACKEND
+#define FILE_SEEKER_BACKEND
+
+/** entry types returned by backends */
+#define fs_type_other 0
+#define fs_type_dir 1
+#define fs_type_reg 2
+
+/** @brief one directory entry; name is valid until next read_dir/close_dir on the same directory. */
+typedef struct fs_entry {
+	const char* name;
+	uint64_t ino;
+	int type;
+} fs_entry;
+
+/** @brief opaque open directory of backend. */
+typedef struct fs_dir fs_dir;
+
+/** @brief traversal backend - how search gets directory listings.
+*
+* access returns 0 if directory can be read; open_dir returns NULL on error (path must stay valid until close_dir); read_dir returns 1 and fills entry, 0 at end of directory, -1 on error; mtime returns modification time of directory in ns (0 if unknown); location returns physical address of first block of directory (0 if unknown) for extent order. prefetch is optional (may be NULL) - hint that directory will be read soon, NULL path drops hints of previous scan. locate is optional too - location of many directories at once (0 for those it couldn't find out), guard backend looks them up in parallel.
+*/
+typedef struct fs_backend {
+	const char* name;
+	int (*access)(struct fs_backend* b, const char* path);
+	fs_dir* (*open_dir)(struct fs_backend* b, const char* path);
+	int (*read_dir)(struct fs_backend* b, fs_dir* dir, fs_entry* entry);
+	void (*close_dir)(struct fs_backend* b, fs_dir* dir);
+	int64_t (*mtime)(struct fs_backend* b, const char* path);
+	uint64_t (*location)(struct fs_backend* b, const char* path);
+	void (*prefetch)(struct fs_backend* b, const char* path);
+	void (*locate)(struct fs_backend* b, const char* const* paths, uint64_t* locations, uint32_t count);
+	void (*destroy)(struct fs_backend* b);
+	void* data;
+} fs_backend;
+
+/** @brief recorded tree served by replay backend - path store nodes with type and child links. */
+typedef struct replay_tree {
+	pathstore ps;
+	uint8_t* type;
+	uint32_t* first_child;
+	uint32_t* last_child;
+	uint32_t* next_sibling;
+	uint32_t capacity;
+} replay_tree;
+
+fs_backend* backend_create(const char* spec);
+fs_backend* backend_posix();
+fs_backend* backend_getdents();
+fs_backend* backend_replay(const char* file);
+fs_backend* backend_replay_tree(replay_tree* t);
+int replay_tree_init(replay_tree* t);
+void replay_tree_free(replay_tree* t);
+int replay_tree_add(replay_tree* t, const char* path, int type);
+int replay_tree_load(replay_tree* t, const char* file);
+
+#endif
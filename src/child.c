@@ -1,7 +1,7 @@
 /** @file child.c
  *  @brief Main children process driver.
  *
- * Child after gaining control initializes itself, setting up sigaction signals handlers. Then it's entering state machine in sleeping status. When it gets SIGUSR1 (so flag=flag_start), then it changes state from flag_start to flag_scanning and calls wrapper function for search (using index argument). After search end/interrupt child checks for the cause and makes appropiate steps. If we got stop signal from overlord, it pauses. If it ended scan by itself, it's sending SIGRTMIN to overlord. If it got start signal, it restarts scan, etc... 
+ * Child after gaining control initializes itself, setting up sigaction signals handlers. Then it's entering state machine in sleeping status. When it gets SIGUSR1 (so flag=flag_start), then it changes state from flag_start to flag_scanning and calls wrapper function for search (using index argument). After search end/interrupt child checks for the cause and makes appropiate steps. If we got stop signal from overlord, it pauses. If it ended scan by itself, it's sending SIGRTMIN to overlord (with value telling if scan was complete or pattern reached its match limit). If it got start signal, it restarts scan, etc... 
  *  @author Kacper Hącia
  */
 
@@ -53,6 +53,24 @@ int send_ack_parent(int sig){
 	}
 }
 
+/** @brief send scan result to parent with SIGRTMIN (value of queued signal)
+ *
+ * @return 0 on success; 1 on error.
+ */
+int send_result_parent(int result){
+	if(ppid>0){
+		union sigval value;
+		value.sival_int = result;
+		sigqueue(ppid, SIGRTMIN, value);
+		return 0;
+	} else {
+		return 1;
+	}
+}
+
+/** @brief result of last scan which ended by itself (scan_complete or scan_satisfied) */
+int scan_result = scan_complete;
+
 /** @brief variable tells us if we ended from sigusr2 (1) or not (0) */
 volatile sig_atomic_t got_sigusr2 = 0;
 
@@ -63,6 +81,7 @@ volatile sig_atomic_t got_sigusr2 = 0;
 * @param data unused, but required by sigaction() handler setting function
 */
 void handle_signals_child(int sig, siginfo_t* si, void* data) {
+	trace_emit(trace_signal, sig, NULL, 0, 0, 0);
 	if(si->si_pid==ppid){
 		switch (sig) {
 			case SIGUSR1:/** case signal SIGUSR1 from overlord - set state to scan. */
@@ -115,10 +134,20 @@ int subdaemon(int index){
 	if (sigaction(SIGCHLD, &sa2, 0) == -1) {
 		return 121;
 	}
+	/** reload (SIGHUP) is overlord's job - children read new config from shared memory */
+	memset(&sa2, 0, sizeof(sa2));
+	sa2.sa_handler = SIG_IGN;
+	if (sigaction(SIGHUP, &sa2, 0) == -1) {
+		return 121;
+	}
 	pid=getpid();
 	ppid=getppid();
 	if(verbose>2)
 		syslog(LOG_DEBUG, "child: parent pid is %d\n", ppid);
+	if(trace_open(index))
+		syslog(LOG_ERR, "child: can't open trace ring, tracing disabled\n");
+	/** handlers are set - tell overlord we're ready for SIGUSRs (handshake) */
+	send_ack_parent(sig_ready);
 	critical_unlock_child();
 	free((void*) children_pids);
 	/** let's launch seeker driver switch... */
@@ -137,7 +166,7 @@ int subdaemon(int index){
 			case flag_scan:/** we entered into scan from flag_scan or restart during previous scan. Let's unlock signals and work. */
 				critical_unlock_child();
 				/** fn call with while flag==flag_scan loop/recursive checking */
-				search_wrapper(index);
+				scan_result = search_wrapper(index);
 
 				/** we have another internal state submachine */
 				switch (flag) {
@@ -163,8 +192,8 @@ int subdaemon(int index){
 			break;
 
 			case flag_stop: /** if flag_stop, we've received SIGUSR2 OR scan ended normally. */
-				if(!got_sigusr2)/** ended by itself */
-					send_ack_parent(SIGRTMIN);
+				if(!got_sigusr2)/** ended by itself - tell overlord if it was complete or pattern got satisfied by its limit */
+					send_result_parent(scan_result);
 				if(verbose&&got_sigusr2){/** external end with SIGUSR2 */
 					syslog(LOG_INFO, "child: GOT SIGUSR2\n");
 					got_sigusr2=0;
@@ -0,0 +1,143 @@
+/** @file config.c
+ *  @brief Shared configuration - pattern set and options visible to all children.
+ *
+ * Patterns come from command line arguments and optional pattern file (-p). Overlord keeps them in anonymous MAP_SHARED memory created before forking, so children read their pattern from there at start of every scan. On SIGHUP overlord rereads pattern file and publishes new pattern set and options to running children - they don't need restart and keep state (e.g. snapshot delta base) for patterns which didn't change.
+ *
+ * Pattern can end with match limit: "pattern/N" stops scan of pattern after N matches, "pattern/exists" after first one (only existence is reported). '/' can't be part of file name, so limit is never mistaken for searched word. Patterns without limit get one from -n option.
+ *
+ * Pattern file has one pattern per line. Empty lines and lines starting with # are skipped. Lines starting with - are options: "-t n" (or "--time n") sets sleep time, "-v", "-vv"... (or "--verbose n") sets verbose level.
+ *  @author Kacper Hącia
+ */
+
+#include "fileseeker.h"
+#include <ctype.h>
+#include <sched.h>
+
+/** @brief configuration shared with children; NULL until config_create. */
+shared_config* config = NULL;
+
+/** @brief path of pattern file (-p option); NULL - patterns only from arguments. */
+char* patterns_file = NULL;
+
+/** @brief default match limit of patterns without own one (-n option). */
+int match_limit = limit_none;
+
+/** @brief Fn maps shared configuration memory. Must be called before forking children.
+ * @return 0 on success; 1 on error.
+ */
+int config_create(){
+	void* mem = mmap(NULL, sizeof(shared_config), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if(mem==MAP_FAILED)
+		return 1;
+	config = mem;
+	memset(config, 0, sizeof(shared_config));
+	return 0;
+}
+
+/** @brief Fn appends pattern to list.
+ * @return 0 on success; 1 if pattern is empty, too long or list is full.
+ */
+int config_add_pattern(pattern_list* list, const char* pattern){
+	size_t len = strlen(pattern);
+	if(!len || len>__file_seeker_max_arg_len || list->count>=__file_seeker_max_patterns)
+		return 1;
+	memcpy(list->patterns[list->count], pattern, len+1);
+	list->count++;
+	return 0;
+}
+
+/** @brief Fn reads pattern file, appending patterns to list.
+*
+* Options from file are returned through new_sleep_time/new_verbose (untouched if file doesn't set them).
+* @return 0 on success; 1 if file can't be opened.
+*/
+int config_read_file(const char* file, pattern_list* list, int* new_sleep_time, int* new_verbose){
+	FILE* f = fopen(file, "r");
+	if(!f)
+		return 1;
+	char line[__file_seeker_max_arg_len+64];
+	while(fgets(line, sizeof(line), f)){
+		size_t len = strcspn(line, "\r\n");
+		if(line[len]==0 && !feof(f)){/** too long line - skip rest of it */
+			int c;
+			while((c = fgetc(f))!=EOF && c!='\n');
+			if(verbose)
+				syslog(LOG_WARNING, "config: too long line in %s skipped\n", file);
+			continue;
+		}
+		line[len] = 0;
+		if(!len || line[0]=='#')
+			continue;
+		if(line[0]=='-'){
+			char* value = line+strcspn(line, " \t");
+			while(isspace((unsigned char) *value))
+				value++;
+			if(!strncmp(line, "-t", 2) || !strncmp(line, "--time", 6)){
+				int t = atoi(value);
+				if(t>0)
+					*new_sleep_time = t;
+			} else if(!strncmp(line, "--verbose", 9)){
+				*new_verbose = atoi(value);
+			} else if(line[1]=='v'){
+				*new_verbose = strspn(line+1, "v");
+			} else if(verbose){
+				syslog(LOG_WARNING, "config: unknown option %s in %s\n", line, file);
+			}
+			continue;
+		}
+		if(config_add_pattern(list, line) && verbose)
+			syslog(LOG_WARNING, "config: pattern %s from %s not added (too long or too many patterns)\n", line, file);
+	}
+	fclose(f);
+	return 0;
+}
+
+/** @brief Fn publishes pattern set and options to children (overlord only). */
+void config_publish(const pattern_list* list, int new_verbose){
+	config->seq++;
+	__sync_synchronize();
+	memcpy(config->patterns, list->patterns, sizeof(list->patterns[0])*list->count);
+	config->pattern_count = list->count;
+	config->verbose = new_verbose;
+	config->generation++;
+	__sync_synchronize();
+	config->seq++;
+}
+
+/** @brief Fn copies pattern of child with given index (and verbose level into global verbose).
+*
+* @param index number of child
+* @param out buffer for at least __file_seeker_max_arg_len+1 chars; empty string if there's no such pattern.
+* @return generation of configuration which was read.
+*/
+unsigned int config_pattern(int index, char* out){
+	unsigned int seq, generation;
+	do {
+		while((seq = config->seq) & 1)
+			sched_yield();
+		__sync_synchronize();
+		if(index<config->pattern_count)
+			memcpy(out, config->patterns[index], __file_seeker_max_arg_len+1);
+		else
+			*out = 0;
+		out[__file_seeker_max_arg_len] = 0;
+		verbose = config->verbose;
+		generation = config->generation;
+		__sync_synchronize();
+	} while(seq!=config->seq);
+	return generation;
+}
+
+/** @brief Fn cuts match limit suffix off pattern - parsed by limit_split, the same way library parses its patterns; invalid suffix is logged and replaced by default.
+*
+* @param pattern pattern; "/limit" suffix is removed in place
+* @return limit of pattern; match_limit if pattern has no (valid) suffix.
+*/
+int config_split_limit(char* pattern){
+	int limit;
+	if(limit_split(pattern, &limit)){
+		syslog(LOG_WARNING, "config: invalid match limit %s of pattern %s, using default\n", pattern+strlen(pattern)+1, pattern);
+		return match_limit;
+	}
+	return (limit==limit_none) ? match_limit : limit;
+}
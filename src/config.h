@@ -0,0 +1,39 @@
+#include "daemon.h"
+#include "walk.h"
+#ifndef FILE_SEEKER_CONFIG
+#define FILE_SEEKER_CONFIG
+
+/** max count of patterns (and children) */
+#define __file_seeker_max_patterns 256
+
+/** @brief configuration shared by overlord and all children (MAP_SHARED memory).
+*
+* Overlord is only writer. seq is sequence lock: it's odd while overlord writes, so reader which saw odd or changed seq retries. Lock-free reading means child killed in the middle of reading can't block anybody.
+*/
+typedef struct shared_config {
+	volatile unsigned int seq;
+	volatile unsigned int generation;
+	volatile int verbose;
+	volatile int pattern_count;
+	char patterns[__file_seeker_max_patterns][__file_seeker_max_arg_len+1];
+} shared_config;
+
+/** @brief pattern list being built from arguments and pattern file. */
+typedef struct pattern_list {
+	int count;
+	char patterns[__file_seeker_max_patterns][__file_seeker_max_arg_len+1];
+} pattern_list;
+
+extern shared_config* config;
+extern char* patterns_file;
+extern int match_limit;
+
+int config_create();
+int config_add_pattern(pattern_list* list, const char* pattern);
+int config_read_file(const char* file, pattern_list* list, int* new_sleep_time, int* new_verbose);
+void config_publish(const pattern_list* list, int new_verbose);
+unsigned int config_pattern(int index, char* out);
+int config_split_limit(char* pattern);
+int load_patterns(pattern_list* list, int* new_sleep_time, int* new_verbose);
+
+#endif
@@ -8,7 +8,14 @@
 ////////////////Abandon all hope, ye who enter here.
 
 #include "daemon.h"
+#include "config.h"
+#include "export.h"
+#include "backend.h"
+#include "guard.h"
+#include "summary.h"
+#include "trace.h"
 #include <assert.h>
+#include <errno.h>
 #include <bits/getopt_core.h>
 #include <bits/types/sigset_t.h>
 #include <semaphore.h>
@@ -33,6 +40,15 @@ const char* program_name;
 /** @brief globa sleep time between waking up */
 int sleep_time = 60;
 
+/** @brief backend used by search; created in main before forking children. */
+fs_backend* backend = NULL;
+
+/** @brief backend specification (-b option): posix, getdents or replay:file. */
+const char* backend_spec = "posix";
+
+/** @brief matching strategy used by search (-m option). */
+int matcher_kind = matcher_strstr;
+
 /** @brief flag for SIGUSRs (machine state changes with signals) */
 volatile sig_atomic_t flag = flag_start;
 
@@ -55,6 +71,9 @@ volatile int gotsigusr1 = 0;
 /** @brief variable to indicate that program got at least one SIGRTMIN from children. */
 volatile int got_at_least_one_sigrtmin = 0;
 
+/** @brief variable to indicate SIGHUP - pattern file should be reloaded. */
+volatile sig_atomic_t reload_requested = 0;
+
 /** @brief global argc */
 int glargc;
 /** @brief global argv */
@@ -89,15 +108,21 @@ volatile int child_sleep_count(){
 	return tmp;
 }
 
-/** @brief Function sets given status in children_pids array for each child.
+/** @brief Function sets given status in children_pids array for each child (start of scan also clears scan results).
  * 
  * @param status - status which function will set for all children.
  */
 void children_status_set(int status){
 	int i = 0;
 	while (i<children_count){
-		//if((children_pids+i)->status!=flag_termination)
+		/** retired slot has nothing to scan - it always sleeps */
+		if((children_pids+i)->retired){
+			i++;
+			continue;
+		}
 			(children_pids+i)->status=status;
+		if(status==flag_scan)
+			(children_pids+i)->result=scan_complete;
 		i++;
 	}
 }
@@ -120,6 +145,16 @@ void children_print_states(){
 int signal_children(int sig){
 	int i = 0;
 	while(i<children_count){
+		/** child without handlers installed would be killed by SIGUSRs; it gets SIGUSR1 from handle_ready when it's ready */
+		if((sig==SIGUSR1 || sig==SIGUSR2) && !(children_pids+i)->ready){
+			i++;
+			continue;
+		}
+		/** reaped retired child - kill(0) would signal whole process group */
+		if((children_pids+i)->pid<=0){
+			i++;
+			continue;
+		}
 		if (verbose > 2)
 			syslog(LOG_DEBUG, "signal: %d -> %d \n",sig,(children_pids+i)->pid);
 		kill((children_pids+i)->pid,sig);
@@ -135,7 +170,8 @@ int signal_children(int sig){
  * it collects zombie kids. Then it tries to fork and subdaemonize new 
  * child. if fork is unsuccesfull, it continues without change. otherwise, 
  * it's setting alive status and saving pid of new children in the place 
- * of old ones. then it checks for previous status of child (by status 
+ * of old ones. new child isn't ready until it sends sig_ready - then
+ * handle_ready checks for previous status of child (by status 
  * in status field of children_pids) and if it was working, it sends SIGUSR1
  * to it. then, it's analyzing next child (if there's any left)
  */
@@ -143,6 +179,18 @@ void check_and_resurrect_children(){
 	int i = 0;
 	critical_lock();
 	while (i<children_count){
+		/** retired child is only reaped (SIGCHLD of two children can come as one, so every one is polled) */
+		if((children_pids+i)->retired){
+			if((children_pids+i)->pid>0 && waitpid((children_pids+i)->pid, NULL, WNOHANG)==(children_pids+i)->pid){
+				if(verbose)
+					syslog(LOG_DEBUG, "overlord: reaped retired child %d\n", (children_pids+i)->pid);
+				(children_pids+i)->pid=0;
+				trace_unlink(i);
+				export_unlink(i);
+			}
+			i++;
+			continue;
+		}
 		if((children_pids+i)->alive==child_dead){
 			int status=0;
 			if(verbose)
@@ -150,21 +198,17 @@ void check_and_resurrect_children(){
 			waitpid((children_pids+i)->pid, &status, WNOHANG);
 			if(verbose)
 				syslog(LOG_DEBUG, "overlord: GOT SIGCHLD \n");
+			(children_pids+i)->ready=0;
 			pid_t newpid=fork();
 			if(newpid==-1)
 				continue;
 			if(newpid==0){//child
-				subdaemon(i);
+				exit(subdaemon(i));
 			}
 			(children_pids+i)->alive=child_alive;
 			(children_pids+i)->pid=newpid;
 			if(verbose)
 				syslog(LOG_DEBUG, "overlord: ressurected %d with status %d \n",(children_pids+i)->pid, (children_pids+i)->status);
-			
-			if ((children_pids+i)->status==flag_scan){
-				kill((children_pids+i)->pid,SIGUSR1);
-			}
-			
 		}
 		i++;
 	}
@@ -211,7 +255,15 @@ void handle_signals(int sig, siginfo_t* si, void* data) {
 		case SIGCHLD:
 			/** let's handle SIGCHLD. we set flag_termination for si_pid wchich sended SIGCHLD */
 			temp=is_child(si->si_pid);
+			/** retired children are reaped by check_and_resurrect_children */
+			if(temp<0)
+				break;
 			(children_pids+temp)->alive=child_dead;
+			(children_pids+temp)->ready=0;
+		break;
+
+		case SIGHUP:
+			reload_requested=1;
 		break;
 
 
@@ -222,36 +274,96 @@ void handle_signals(int sig, siginfo_t* si, void* data) {
 
 /** @brief Fn handles real-time signals from children signalising end of work.
 *
+* Value of queued signal tells if child's scan was complete or its pattern reached match limit (scan_satisfied).
 * @param sig signal we have received
 * @param si siginfo_t element containing info about signal
 * @param data unused, but required by sigaction() handler setting function
 */
 void handle_rt(int sig, siginfo_t* si, void* data){
 	int temp=is_child(si->si_pid);
+	if(temp<0 || (children_pids+temp)->retired)
+		return;
 	(children_pids+temp)->status=flag_sleep;
+	(children_pids+temp)->result=(si->si_code==SI_QUEUE) ? si->si_value.sival_int : scan_complete;
 	got_at_least_one_sigrtmin=1;
 	return;
 }
 
-/** @brief function masks SIGUSR1, SIGUSR2, SIGRTMIN (real - time signals from children) input BEFORE critical sections. */
+/** @brief Fn handles sig_ready from children - child installed its handlers and can get SIGUSRs.
+*
+* If child was (re)spawned in the middle of scan, it's started here.
+* @param sig signal we have received
+* @param si siginfo_t element containing info about signal
+* @param data unused, but required by sigaction() handler setting function
+*/
+void handle_ready(int sig, siginfo_t* si, void* data){
+	int temp=is_child(si->si_pid);
+	if(temp<0 || (children_pids+temp)->retired)
+		return;
+	(children_pids+temp)->ready=1;
+	if((children_pids+temp)->status==flag_scan)
+		kill(si->si_pid, SIGUSR1);
+}
+
+/** @brief Fn waits (at most timeout seconds) until all children send sig_ready.
+*
+* sig_ready must be blocked before children are forked - then no signal is lost and we can collect them with sigtimedwait.
+* @return count of ready children.
+*/
+int wait_for_children_ready(int timeout){
+	sigset_t sigmask;
+	sigemptyset(&sigmask);
+	sigaddset(&sigmask, sig_ready);
+	struct timespec deadline, now, left;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout;
+	int ready = 0;
+	while(ready<children_count){
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		left.tv_sec = deadline.tv_sec - now.tv_sec;
+		left.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+		if(left.tv_nsec<0){
+			left.tv_sec--;
+			left.tv_nsec += 1000000000;
+		}
+		if(left.tv_sec<0)
+			break;
+		siginfo_t si;
+		if(sigtimedwait(&sigmask, &si, &left)<0){
+			if(errno==EINTR)
+				continue;
+			break;
+		}
+		int temp=is_child(si.si_pid);
+		if(temp>=0 && !(children_pids+temp)->ready){
+			(children_pids+temp)->ready=1;
+			ready++;
+		}
+	}
+	return ready;
+}
+
+/** @brief function masks SIGUSR1, SIGUSR2, SIGRTMIN and sig_ready (real - time signals from children) input BEFORE critical sections. */
 void critical_lock(){
 	sigset_t sigmask;
 	sigemptyset(&sigmask);
 	sigaddset(&sigmask, SIGUSR1);
 	sigaddset(&sigmask, SIGUSR2);
 	sigaddset(&sigmask, SIGRTMIN);
+	sigaddset(&sigmask, sig_ready);
 	sigprocmask(SIG_BLOCK, &sigmask, NULL);
 }
 
 
 
-/** @brief function UNmasks SIGUSR1, SIGUSR2, SIGRTMIN (real - time signals from children) input AFTER critical sections. */
+/** @brief function UNmasks SIGUSR1, SIGUSR2, SIGRTMIN and sig_ready (real - time signals from children) input AFTER critical sections. */
 void critical_unlock(){
 	sigset_t sigmask;
 	sigemptyset(&sigmask);
 	sigaddset(&sigmask, SIGUSR1);
 	sigaddset(&sigmask, SIGUSR2);
 	sigaddset(&sigmask, SIGRTMIN);
+	sigaddset(&sigmask, sig_ready);
 	sigprocmask(SIG_UNBLOCK, &sigmask, NULL);
 }
 
@@ -281,7 +393,39 @@ int main(int argc, char** argv){
 	/** Function call options_handler to handle options and set optind for overlord. */
 	options_handler(argc, argv);
 
-	children_count=argc-optind;
+	/** Collect patterns from arguments and pattern file and share them with future children. */
+	pattern_list* list = calloc(1, sizeof(pattern_list));
+	if(!list || config_create())
+		abort();
+	if(load_patterns(list, &sleep_time, &verbose)){
+		fprintf(stderr, "Error: can't read pattern file %s\n", patterns_file);
+		free(list);
+		return 1;
+	}
+	if(!list->count){
+		free(list);
+		return print_usage(stdout, 1);
+	}
+	config_publish(list, verbose);
+	children_count=list->count;
+	/** Summaries for pruning are shared by all children - mapped before they're forked. */
+	if(prune_rescan && summary_create()){
+		fprintf(stderr, "Warning: can't map subtree summaries, pruning disabled\n");
+		prune_rescan = 0;
+	}
+	free(list);
+
+	/** Create traversal backend - replay one loads its tree here, so children share it copy-on-write. */
+	backend = backend_create(backend_spec);
+	if(!backend){
+		fprintf(stderr, "Error: can't create backend %s\n", backend_spec);
+		return 1;
+	}
+	/** With per-directory timeout backend is read by helper threads (started in children, after fork). */
+	if(dir_timeout && !(backend = backend_guard(backend))){
+		fprintf(stderr, "Error: can't create helper threads of backend\n");
+		return 1;
+	}
 
 	/** Initalizes array for children_pids with memset to 0. */
 	children_pids = malloc(sizeof(child_info)*children_count);
@@ -301,6 +445,169 @@ int main(int argc, char** argv){
 }
 
 
+/** @brief Fn collects patterns from arguments (after optind) and from pattern file (if set).
+*
+* @param list list to fill
+* @param new_sleep_time sleep time; changed if pattern file sets it
+* @param new_verbose verbose level; changed if pattern file sets it
+* @return 0 on success; 1 if pattern file can't be read.
+*/
+int load_patterns(pattern_list* list, int* new_sleep_time, int* new_verbose){
+	for(int i=optind;i<glargc;i++){
+		if(config_add_pattern(list, *(glargv+i)))
+			syslog(LOG_WARNING, "overlord: pattern %s not added (empty, longer than %d chars or too many patterns)\n", *(glargv+i), __file_seeker_max_arg_len);
+	}
+	if(patterns_file)
+		return config_read_file(patterns_file, list, new_sleep_time, new_verbose);
+	return 0;
+}
+
+/** @brief Fn compares patterns without their match limits - change of limit alone keeps child of pattern. */
+static int same_pattern(const char* a, const char* b){
+	const char* slash_a = strrchr(a, '/');
+	const char* slash_b = strrchr(b, '/');
+	size_t len_a = slash_a ? (size_t) (slash_a-a) : strlen(a);
+	size_t len_b = slash_b ? (size_t) (slash_b-b) : strlen(b);
+	return len_a==len_b && !strncmp(a, b, len_a);
+}
+
+/** @brief Fn terminates child of removed pattern without waiting for it - it can be stuck in I/O on hung mount; check_and_resurrect_children reaps it. */
+static void retire_child(int slot){
+	if(verbose)
+		syslog(LOG_INFO, "overlord: pattern of child %d removed, terminating it\n", (children_pids+slot)->pid);
+	(children_pids+slot)->retired=1;
+	(children_pids+slot)->status=flag_sleep;
+	(children_pids+slot)->ready=0;
+	if((children_pids+slot)->pid>0)
+		kill((children_pids+slot)->pid, SIGTERM);
+	else {/** never started - nothing to reap */
+		(children_pids+slot)->pid=0;
+		trace_unlink(slot);
+		export_unlink(slot);
+	}
+}
+
+/** @brief Fn starts child for new pattern in slot (joins scan in progress as soon as it's ready). */
+static void start_child(int slot){
+	memset((void*) (children_pids+slot), 0, sizeof(child_info));
+	(children_pids+slot)->status = (flag==flag_scan) ? flag_scan : flag_sleep;
+	(children_pids+slot)->result = scan_complete;
+	pid_t newpid=fork();
+	if(newpid==0)
+		exit(subdaemon(slot));
+	(children_pids+slot)->pid=newpid;
+	(children_pids+slot)->alive=(newpid>0) ? child_alive : child_dead;
+}
+
+/** @brief Fn reloads pattern file and options and passes them to running children (SIGHUP).
+*
+* Children are matched to new patterns by value, not by position: child whose pattern is still in the set keeps it (with its matcher, statistics, summaries and export delta chain), also when only its match limit changed. Children of removed patterns are retired - they get SIGTERM and are reaped later with WNOHANG, so child stuck on hung mount can't block overlord. New patterns get free slots (of reaped retired children) or new ones; children are forked for them. Slot is index of child, so names of its trace ring, results and snapshots stay the same.
+*/
+void reload_config(){
+	pattern_list* list = calloc(1, sizeof(pattern_list));
+	pattern_list* slots = calloc(1, sizeof(pattern_list));
+	if(!list || !slots){
+		free(list);
+		free(slots);
+		return;
+	}
+	int new_sleep_time = sleep_time;
+	int new_verbose = verbose;
+	if(load_patterns(list, &new_sleep_time, &new_verbose) || !list->count){
+		syslog(LOG_ERR, "overlord: reload failed - can't read %s or no patterns; keeping old configuration\n", patterns_file ? patterns_file : "pattern file");
+		free(list);
+		free(slots);
+		return;
+	}
+	/** block everything which touches children_pids */
+	sigset_t sigmask, oldmask;
+	sigemptyset(&sigmask);
+	sigaddset(&sigmask, SIGUSR1);
+	sigaddset(&sigmask, SIGUSR2);
+	sigaddset(&sigmask, SIGRTMIN);
+	sigaddset(&sigmask, sig_ready);
+	sigaddset(&sigmask, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &sigmask, &oldmask);
+
+	/** slots with the same pattern first, then ones where only limit changed */
+	int taken[__file_seeker_max_patterns] = {0};
+	int kept = 0, retired = 0, started = 0;
+	slots->count = children_count;
+	for(int pass=0;pass<2;pass++)
+		for(int i=0;i<children_count;i++){
+			if((children_pids+i)->retired || *slots->patterns[i])
+				continue;
+			for(int j=0;j<list->count;j++)
+				if(!taken[j] && (pass ? same_pattern(config->patterns[i], list->patterns[j]) : !strcmp(config->patterns[i], list->patterns[j]))){
+					taken[j] = 1;
+					strcpy(slots->patterns[i], list->patterns[j]);
+					kept++;
+					break;
+				}
+		}
+	for(int i=0;i<children_count;i++)
+		if(!(children_pids+i)->retired && !*slots->patterns[i]){
+			retire_child(i);
+			retired++;
+		}
+	/** new patterns go to reaped retired slots, then past the end */
+	int* fresh = calloc(list->count, sizeof(int));
+	int fresh_count = 0;
+	for(int j=0;fresh && j<list->count;j++){
+		if(taken[j])
+			continue;
+		int slot = -1;
+		for(int i=0;i<slots->count && slot<0;i++)
+			if((children_pids+i)->retired && (children_pids+i)->pid==0 && !*slots->patterns[i])
+				slot = i;
+		if(slot<0 && slots->count<__file_seeker_max_patterns)
+			slot = slots->count++;
+		if(slot<0){
+			syslog(LOG_ERR, "overlord: no free child slot, pattern %s isn't searched\n", list->patterns[j]);
+			continue;
+		}
+		strcpy(slots->patterns[slot], list->patterns[j]);
+		fresh[fresh_count++] = slot;
+	}
+	/** trailing reaped slots aren't needed anymore */
+	while(slots->count>0 && !*slots->patterns[slots->count-1] && (children_pids+slots->count-1)->retired && (children_pids+slots->count-1)->pid==0)
+		slots->count--;
+	if(slots->count>children_count){
+		child_info_ptr tmp = realloc((void*) children_pids, sizeof(child_info)*slots->count);
+		if(tmp){
+			children_pids = tmp;
+		} else {
+			syslog(LOG_ERR, "overlord: out of memory - new patterns aren't searched\n");
+			for(int i=children_count;i<slots->count;i++)
+				*slots->patterns[i] = 0;
+			slots->count = children_count;
+		}
+	}
+	/** new slots past old end are marked retired until their child is started */
+	for(int i=children_count;i<slots->count;i++){
+		memset((void*) (children_pids+i), 0, sizeof(child_info));
+		(children_pids+i)->retired=1;
+		(children_pids+i)->status=flag_sleep;
+	}
+	sleep_time = new_sleep_time;
+	verbose = new_verbose;
+	/** children read pattern of their slot from shared config - publish before forking */
+	config_publish(slots, verbose);
+	children_count = slots->count;
+	for(int i=0;i<fresh_count;i++){
+		if(fresh[i]>=children_count)
+			continue;
+		start_child(fresh[i]);
+		started++;
+	}
+	free(fresh);
+	if(verbose)
+		syslog(LOG_INFO, "overlord: reloaded configuration - %d patterns (%d kept, %d new, %d removed), sleep time %d\n", kept+started, kept, started, retired, sleep_time);
+	sigprocmask(SIG_SETMASK, &oldmask, NULL);
+	free(list);
+	free(slots);
+}
+
 /** @brief Fn is driver for creating (calling create_subdaemons) and overwatching working process.
 *
 * @param argc number of args; always at least 1 (for index 0 - program name).
@@ -309,13 +616,22 @@ int main(int argc, char** argv){
 int overlord(int argc, char**argv){
 	/** we have chlidren_count children; and children_count = argc - optind; */
 	
+	/** children report with sig_ready that their handlers are installed - block it, so no report is lost before we wait for them. SIGHUP is blocked too - reload sent right after start (service manager) would kill us before our handler is installed; it waits and is handled then. */
+	sigset_t readymask;
+	sigemptyset(&readymask);
+	sigaddset(&readymask, sig_ready);
+	sigaddset(&readymask, SIGHUP);
+	sigprocmask(SIG_BLOCK, &readymask, NULL);
+
 	/** create our subdaemons */
 	create_subdaemons(argc, argv);
 
-	/** let our children init themself by sleeping a while */
-	sleep(1+children_count/5);
 	if(pid){//overlord process
 		pid = getpid();
+		/** wait for handshake from our children instead of sleeping blindly; late ones are started by handle_ready. */
+		int ready = wait_for_children_ready(5+children_count/5);
+		if(verbose>2)
+			syslog(LOG_DEBUG, "overlord: %d of %d children ready\n", ready, children_count);
 		/** Handle SIGTERM */
 		/** Registers handlers for SIGUSRs. */
 		struct sigaction sa1;
@@ -342,8 +658,9 @@ int overlord(int argc, char**argv){
 			free((void*)children_pids);
 			return 123;
 		}	
+		/** stopped (or continued) child isn't dead - it mustn't be resurrected next to itself */
 		memset(&sa2, 0, sizeof(sa2));
-		sa2.sa_flags = SA_SIGINFO;
+		sa2.sa_flags = SA_SIGINFO | SA_NOCLDSTOP;
 		sa2.sa_sigaction = handle_signals;
 		if (sigaction(SIGCHLD, &sa2, 0) == -1) {
 			free((void*)children_pids);
@@ -356,6 +673,25 @@ int overlord(int argc, char**argv){
 			free((void*)children_pids);
 			return 121;
 		}
+		memset(&sa2, 0, sizeof(sa2));
+		sa2.sa_flags = SA_SIGINFO;
+		sa2.sa_sigaction = handle_ready;
+		if (sigaction(sig_ready, &sa2, 0) == -1) {
+			free((void*)children_pids);
+			return 121;
+		}
+		memset(&sa1, 0, sizeof(sa1));
+		sa1.sa_flags = SA_SIGINFO;
+		sa1.sa_sigaction = handle_signals;
+		if (sigaction(SIGHUP, &sa1, 0) == -1) {
+			free((void*)children_pids);
+			return 124;
+		}
+		/** SIGHUP pending since start is delivered now - first pass of loop reloads configuration */
+		sigset_t hupmask;
+		sigemptyset(&hupmask);
+		sigaddset(&hupmask, SIGHUP);
+		sigprocmask(SIG_UNBLOCK, &hupmask, NULL);
 
 
 		/** let's start our first scan! */
@@ -363,6 +699,13 @@ int overlord(int argc, char**argv){
 		flag = flag_start;
 
 		while (1) {
+			/** SIGHUP - reload patterns and options; state machine goes on */
+			if(reload_requested){
+				reload_requested=0;
+				if(verbose)
+					syslog(LOG_INFO, "overlord: GOT SIGHUP\n");
+				reload_config();
+			}
 			switch (flag) {
 				case flag_start: /** case flag==flag_start: send SIGUSR1 to child to start search */
 					if(gotsigusr1==1){
@@ -412,6 +755,13 @@ int overlord(int argc, char**argv){
 						flag=flag_sleep;
 						if (verbose > 2)
 							syslog(LOG_DEBUG, "overlord: all children sleeps\n");
+						if (verbose){
+							int satisfied = 0;
+							for(int i=0;i<children_count;i++)
+								satisfied += ((children_pids+i)->result==scan_satisfied);
+							if(satisfied)
+								syslog(LOG_INFO, "overlord: scan done; %d of %d patterns satisfied by match limit\n", satisfied, children_count);
+						}
 					} else if (flag==flag_scan) {
 						/** if not all children are in state of sleeping, it means there are working childrens. */
 						if (verbose > 2)
@@ -429,7 +779,17 @@ int overlord(int argc, char**argv){
 					critical_unlock();
 					if (verbose)
 						syslog(LOG_INFO, "overlord: went to sleep for %d seconds; job done\n", sleep_time);
-					sleep(sleep_time);
+					/** SIGHUP (or SIGCHLD) interrupts sleep - reload and sleep rest of time */
+					unsigned int left = sleep_time;
+					while(left>0 && flag==flag_sleep){
+						left = sleep(left);
+						if(reload_requested){
+							reload_requested=0;
+							if(verbose)
+								syslog(LOG_INFO, "overlord: GOT SIGHUP\n");
+							reload_config();
+						}
+					}
 					check_and_resurrect_children();
 					switch (flag) {
 						case flag_sleep: /** if we were sleeping for sleep_time without state change, let's start scan */
@@ -450,10 +810,15 @@ int overlord(int argc, char**argv){
 					/** collect zombie childrens */
 					if(verbose)
 						syslog(LOG_INFO, "overlord: GOT SIGTERM\n");
-					for(int i=optind;i<glargc;i++){
+					for(int i=0;i<children_count;i++){
 						wait(NULL);
 
 					}
+					/** remove shared memory of children */
+					for(int i=0;i<children_count;i++){
+						trace_unlink(i);
+						export_unlink(i);
+					}
 					/** deallocate children_pids */
 					free((void*) children_pids);
 					return 0;
@@ -479,7 +844,7 @@ int create_subdaemons(int argc, char** argv){
 	for(int i=0;i<children_count;i++){
 		pid=fork();
 		if(pid == 0){
-			subdaemon(i);
+			exit(subdaemon(i));
 		}
 		/** and let's save child pid in children_pids pid field. */
 		(children_pids+i)->pid=pid;
@@ -488,6 +853,8 @@ int create_subdaemons(int argc, char** argv){
 		/** and let's also save startup child status and alive status in children_pids status and alive field. */
 		(children_pids+i)->status=flag_sleep;
 		(children_pids+i)->alive=child_alive;
+		(children_pids+i)->ready=0;
+		(children_pids+i)->result=scan_complete;
 	}
 	return 0;
 }
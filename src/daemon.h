@@ -27,18 +27,28 @@
 #define flag_stop 3
 #define flag_termination 4
 
+/** scan results sent by child with SIGRTMIN (sigqueue value) */
+#define scan_complete 0
+#define scan_satisfied 1
+
+/** signal sent by child to overlord when it's ready for work (handlers installed) */
+#define sig_ready (SIGRTMIN+1)
+
 /** alive states */
 #define child_alive 1
 #define child_dead 0
 
 /** @brief struct for holding data about childrens - pids and their status.
 *
-*
+* retired slot has no pattern since reload: its child got SIGTERM and is reaped without waiting (pid 0 once reaped), it's never resurrected and slot can take new pattern after reaping.
 */
 typedef volatile struct chld_info {
 	volatile pid_t pid;
 	volatile sig_atomic_t status;
 	volatile sig_atomic_t alive;
+	volatile sig_atomic_t ready;
+	volatile sig_atomic_t result;
+	volatile sig_atomic_t retired;
 } child_info, * volatile child_info_ptr;
 
 int print_usage(FILE* stream, int exit_code);
@@ -48,5 +58,6 @@ int create_subdaemons(int argc, char** argv);
 void critical_lock();
 void critical_unlock();
 int subdaemon(int index);
+void reload_config();
 
 #endif
@@ -0,0 +1,185 @@
+/** @file export.c
+ *  @brief Per-cycle snapshot export driver.
+ *
+ * When snapshot directory is set (-s option), child collects every match of current scan into snapshot. When scan ends by itself, snapshot is sorted and written into snapshot directory as host-index-time-cycle.fss file. First cycle (and every snapshot_full_every-th one) writes full snapshot; other cycles write only delta against previous cycle, so collector fetches only changes. Interrupted scans (SIGUSR1 restart, SIGUSR2 stop) are dropped - their index would be incomplete.
+ *
+ * With -r the same matches are also published into shared memory (results.c) for lock-free readers such as tools/fsquery - set of finished scan replaces previous one atomically. Scan which ran out of its time budget (-d option) is published as partial set with subtrees it searched whole, scan which pruned subtrees by summaries (-P option) as provisional one; neither writes snapshot.
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "fileseeker.h"
+#include <stdint.h>
+
+/** @brief directory for snapshots; NULL - export disabled. */
+char* snapshot_dir = NULL;
+
+/** @brief every n-th exported snapshot is full one; others are deltas. */
+int snapshot_full_every = 10;
+
+/** @brief publish results of scans into shared memory (-r option). */
+int results_enabled = 0;
+
+/** @brief shared memory results of this child and whether current scan is being collected into them. */
+static results_writer writer;
+static int writer_ready = 0;
+static int publishing = 0;
+
+/** @brief snapshot of scan in progress. */
+static snapshot current;
+/** @brief snapshot of last exported scan - base for deltas. */
+static snapshot previous;
+/** @brief 1 if previous holds valid snapshot. */
+static int have_previous = 0;
+/** @brief 1 between export_begin and export_end/export_abort. */
+static int collecting = 0;
+/** @brief number of exported snapshots since last full one. */
+static int since_full = 0;
+/** @brief number of exported snapshots; part of file name. */
+static unsigned int cycle = 0;
+/** @brief index of child - part of file name. */
+static int child_index = 0;
+
+/** @brief Fn builds shm name of results header of child with given index of overlord owner. */
+static void results_name(char* name, size_t size, int owner, int index){
+	snprintf(name, size, "/fileseeker-results.%d.%d", owner, index);
+}
+
+/** @brief Fn removes published results of child with given index (overlord only, after child is reaped). */
+void export_unlink(int index){
+	if(!results_enabled)
+		return;
+	char name[48];
+	results_name(name, sizeof(name), (int) getpid(), index);
+	results_unlink(name);
+}
+
+/** @brief Fn starts collecting matches for new scan.
+*
+* @param index number of child
+* @param pattern pattern searched by child
+*/
+void export_begin(int index, const char* pattern){
+	if(results_enabled && !writer_ready){
+		char name[48];
+		results_name(name, sizeof(name), (int) ppid, index);
+		if(results_writer_open(&writer, name, index)){
+			syslog(LOG_ERR, "export: can't map results %s, publishing disabled\n", name);
+			results_enabled = 0;
+		} else {
+			writer_ready = 1;
+		}
+	}
+	if(writer_ready){
+		results_reset(&writer);
+		publishing = 1;
+	}
+	if(!snapshot_dir)
+		return;
+	if(collecting)
+		snapshot_free(&current);
+	char host[256];
+	if(gethostname(host, sizeof(host)))
+		strcpy(host, "localhost");
+	host[sizeof(host)-1] = 0;
+	snapshot_init(&current, snapshot_full, time(NULL));
+	snapshot_add_host(&current, host);
+	snapshot_add_pattern(&current, pattern);
+	child_index = index;
+	collecting = 1;
+}
+
+/** @brief Fn adds found path to snapshot of current scan. */
+void export_match(const char* path, int is_dir){
+	if(publishing && results_add(&writer, path, is_dir)){
+		syslog(LOG_ERR, "export: out of memory, results of this scan won't be published\n");
+		publishing = 0;
+	}
+	if(!collecting)
+		return;
+	if(snapshot_add(&current, path, 0, 0, snapshot_op_add, is_dir) && verbose)
+		syslog(LOG_ERR, "export: out of memory, match %s not exported\n", path);
+}
+
+/** @brief Fn records subtree searched whole by scan with time budget (-d option) - partial results list it as covered. */
+void export_covered(const char* path){
+	if(publishing && results_cover(&writer, path)){
+		syslog(LOG_ERR, "export: out of memory, covered subtree %s not listed\n", path);
+	}
+}
+
+/** @brief Fn drops snapshot of interrupted scan. */
+void export_abort(){
+	publishing = 0;
+	if(!collecting)
+		return;
+	snapshot_free(&current);
+	collecting = 0;
+}
+
+/** @brief Fn publishes results of scan which isn't complete index - cut short by its time budget (partial set with covered subtrees) or with pruned subtrees (provisional set).
+*
+* Snapshot is dropped like in export_abort - delta against it would report paths outside covered subtrees as deleted, and pruned subtrees can hide new names.
+* @param flags results_partial and/or results_provisional
+*/
+void export_partial(int flags){
+	if(publishing){
+		publishing = 0;
+		if(results_publish(&writer, flags))
+			syslog(LOG_ERR, "export: couldn't publish %s results, readers keep previous ones\n", (flags & results_partial) ? "partial" : "provisional");
+		else if(verbose>2)
+			syslog(LOG_DEBUG, "export: published %s results epoch %llu with %u paths\n", (flags & results_partial) ? "partial" : "provisional", (unsigned long long) writer.header->epoch, writer.count);
+	}
+	export_abort();
+}
+
+/** @brief Fn publishes results and writes snapshot of finished scan (full or delta) and keeps it as base for next delta. */
+void export_end(){
+	if(publishing){
+		publishing = 0;
+		if(results_publish(&writer, 0))
+			syslog(LOG_ERR, "export: couldn't publish results, readers keep previous ones\n");
+		else if(verbose>2)
+			syslog(LOG_DEBUG, "export: published results epoch %llu with %u paths\n", (unsigned long long) writer.header->epoch, writer.count);
+	}
+	if(!collecting)
+		return;
+	collecting = 0;
+	snapshot_sort(&current);
+
+	/** pattern or host change makes previous snapshot useless as delta base */
+	int full = !have_previous || since_full+1>=snapshot_full_every
+		|| strcmp(previous.patterns[0], current.patterns[0]) || strcmp(previous.hosts[0], current.hosts[0]);
+	snapshot delta;
+	const snapshot* out = &current;
+	if(!full){
+		if(snapshot_diff(&previous, &current, &delta)){
+			snapshot_free(&delta);
+			full = 1;
+		} else {
+			out = &delta;
+		}
+	}
+
+	char* file = NULL;
+	if(asprintf(&file, "%s/%s-%d-%llu-%u.fss", snapshot_dir, current.hosts[0], child_index, (unsigned long long) current.time, cycle)<0){
+		file = NULL;
+	}
+	if(!file || snapshot_write(out, file)){
+		syslog(LOG_ERR, "export: couldn't write snapshot %s\n", file ? file : snapshot_dir);
+		/** next export must be full - collector didn't get this one */
+		since_full = snapshot_full_every;
+	} else {
+		if(verbose)
+			syslog(LOG_INFO, "export: wrote %s snapshot %s with %zu records\n", full ? "full" : "delta", file, out->count);
+		since_full = full ? 0 : since_full+1;
+		cycle++;
+	}
+	free(file);
+	if(!full)
+		snapshot_free(&delta);
+	if(have_previous)
+		snapshot_free(&previous);
+	previous = current;
+	have_previous = 1;
+}
@@ -0,0 +1,16 @@
+#ifndef FILE_SEEKER_EXPORT
+#define FILE_SEEKER_EXPORT
+
+extern char* snapshot_dir;
+extern int snapshot_full_every;
+extern int results_enabled;
+
+void export_begin(int index, const char* pattern);
+void export_match(const char* path, int is_dir);
+void export_end();
+void export_covered(const char* path);
+void export_partial(int flags);
+void export_abort();
+void export_unlink(int index);
+
+#endif
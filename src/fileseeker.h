@@ -2,5 +2,16 @@
 #include "utility.h"
 #include "child.h"
 #include "recsearch.h"
+#include "snapshot.h"
+#include "export.h"
+#include "pathstore.h"
+#include "config.h"
+#include "trace.h"
+#include "backend.h"
+#include "matcher.h"
+#include "heat.h"
+#include "summary.h"
+#include "results.h"
+#include "guard.h"
 
 #define MAX_PATH_LEN 2048
@@ -0,0 +1,759 @@
+/** @file guard.c
+ *  @brief Guard backend - directory reads in helper threads, bounded by per-directory timeout.
+ *
+ * Directory on hung NFS server or FUSE mount blocks opendir/readdir (and stat) in uninterruptible sleep - child wouldn't see SIGUSR2 nor end of its time budget, and whole cycle would wait for it. With -D ms option search backend is wrapped by guard: access of directory hands whole listing (access, open, read of all entries, close) to pool of helper threads and waits for it, checking scan flag meanwhile; open_dir and read_dir then serve the listing from memory. Timeout is measured from the last step of listing, not from its start - thread counts every call which returned (progress), so big healthy directory can take as long as it needs, and only thread stuck inside one call for ms gives directory up; time spent in queue counts only while no thread makes progress. Directories announced by prefetch (next subdirectories in inode and extent order) are listed by free threads ahead of time - at most guard_threads-1 at once, so one thread is always left for directory search waits for - and first blocks of all subdirectories of directory (extent order) are looked up by them in one batch, so disk gets several requests at once. Directory which doesn't answer in time is given up (its thread stays stuck in kernel and is replaced by new one) and mount it lives on (found in /proc/self/mounts) is marked degraded - its directories are skipped for backoff period, which doubles with every next timeout, while the rest of tree is searched as usual.
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "fileseeker.h"
+#include <errno.h>
+#include <pthread.h>
+
+/** @brief per-directory timeout in ms (-D option); 0 - directories are read directly. */
+int dir_timeout = 0;
+
+/** @brief count of helper threads (--dir-threads option). */
+int guard_threads = guard_default_threads;
+
+/** job types */
+#define job_list 0
+#define job_mtime 1
+#define job_location 2
+
+/** job states */
+#define job_queued 0
+#define job_running 1
+#define job_done 2
+#define job_abandoned 3
+#define job_dropped 4
+
+/** @brief one directory read handed to helper thread.
+*
+* Listing is kept in buf as records: type byte, inode (8 bytes) and name with terminating zero. After job is done it's also open directory of guard backend (pos - next record). Abandoned job (timed out) and dropped one (prefetch nobody asked for) are freed by their thread when (if ever) the call returns. progress counts calls of job which returned (written by its thread without lock). prefetch marks job read ahead nobody waits for yet, prefetching one which was started as such (it holds one of prefetch threads).
+*/
+typedef struct guard_job {
+	int type;
+	int state;
+	int prefetch;
+	int prefetching;
+	uint32_t progress;
+	int access_err;
+	int open_err;
+	int64_t mtime;
+	uint64_t location;
+	char* buf;
+	size_t len;
+	size_t cap;
+	size_t pos;
+	struct guard_job* next;
+	char path[MAX_PATH_LEN];
+} guard_job;
+
+/** @brief state of guard backend.
+*
+* lock guards queue, job states and thread counters (stuck - threads running abandoned jobs, prefetch_running - threads running prefetch jobs); progress counts calls of all jobs which returned (written without lock); mount table, pending and prefetched jobs are used by search thread only. pending is listing done by access, waiting for open_dir of the same path; prefetched are listings of directories announced by prefetch, which are read ahead; timed_out is directory whose stat has just timed out, so its skip is reported as timeout (not degraded mount).
+*/
+typedef struct guard_state {
+	fs_backend* inner;
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+	guard_job* head;
+	guard_job* tail;
+	int threads;
+	int stuck;
+	int prefetch_running;
+	int closing;
+	uint32_t progress;
+	guard_job* pending;
+	guard_job* prefetched[guard_prefetch_max];
+	int prefetch_count;
+	guard_mount* mounts;
+	int mount_count;
+	int64_t mounts_time;
+	char timed_out[MAX_PATH_LEN];
+} guard_state;
+
+static int64_t guard_now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+static void job_free(guard_job* job){
+	free(job->buf);
+	free(job);
+}
+
+/** @brief appends entry to listing of job. */
+static int job_add(guard_job* job, const fs_entry* entry){
+	size_t name_len = strlen(entry->name)+1;
+	size_t need = job->len+1+sizeof(uint64_t)+name_len;
+	if(need>job->cap){
+		size_t cap = job->cap ? job->cap : 4096;
+		while(cap<need)
+			cap *= 2;
+		char* tmp = realloc(job->buf, cap);
+		if(!tmp)
+			return 1;
+		job->buf = tmp;
+		job->cap = cap;
+	}
+	job->buf[job->len] = entry->type;
+	memcpy(job->buf+job->len+1, &entry->ino, sizeof(uint64_t));
+	memcpy(job->buf+job->len+1+sizeof(uint64_t), entry->name, name_len);
+	job->len = need;
+	return 0;
+}
+
+/** @brief Fn counts call of job which returned - waiting search sees directory still answers. */
+static void job_step(guard_state* g, guard_job* job){
+	__atomic_add_fetch(&job->progress, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&g->progress, 1, __ATOMIC_RELAXED);
+}
+
+/** @brief does the blocking part of job - this is where thread can get stuck; every call which returns is counted (job_step). */
+static void job_run(guard_state* g, guard_job* job){
+	fs_backend* inner = g->inner;
+	errno = 0;
+	if(job->type==job_mtime){
+		job->mtime = inner->mtime(inner, job->path);
+		return;
+	}
+	if(job->type==job_location){
+		job->location = inner->location(inner, job->path);
+		return;
+	}
+	if(inner->access(inner, job->path)){
+		job->access_err = errno ? errno : EACCES;
+		return;
+	}
+	job_step(g, job);
+	fs_dir* dir = inner->open_dir(inner, job->path);
+	if(!dir){
+		job->open_err = errno ? errno : EIO;
+		return;
+	}
+	job_step(g, job);
+	fs_entry entry;
+	while(inner->read_dir(inner, dir, &entry)>0){
+		job_step(g, job);
+		if(job_add(job, &entry))
+			break;
+	}
+	inner->close_dir(inner, dir);
+}
+
+/** @brief Fn gives job thread can take (lock held) - prefetch jobs (always behind jobs search waits for) only while fewer than guard_threads-1 of them run.
+ * @return job at head of queue; NULL if there's none to take.
+ */
+static guard_job* queue_next(guard_state* g){
+	guard_job* job = g->head;
+	if(job && job->prefetch && g->prefetch_running>=guard_threads-1)
+		return NULL;
+	return job;
+}
+
+/** @brief helper thread - takes jobs from queue until backend is destroyed; last one out frees state. */
+static void* guard_worker(void* arg){
+	guard_state* g = arg;
+	pthread_mutex_lock(&g->lock);
+	for(;;){
+		while(!queue_next(g) && !g->closing)
+			pthread_cond_wait(&g->work, &g->lock);
+		guard_job* job = queue_next(g);
+		if(!job)
+			break;
+		if(!(g->head = job->next))
+			g->tail = NULL;
+		job->state = job_running;
+		if((job->prefetching = job->prefetch))
+			g->prefetch_running++;
+		pthread_mutex_unlock(&g->lock);
+		job_run(g, job);
+		pthread_mutex_lock(&g->lock);
+		/** next prefetch job can start */
+		if(job->prefetching){
+			g->prefetch_running--;
+			pthread_cond_signal(&g->work);
+		}
+		if(job->state==job_abandoned){/** search gave up on it long ago - thread is free again */
+			g->stuck--;
+			job_free(job);
+		} else if(job->state==job_dropped){
+			job_free(job);
+		} else {
+			job->state = job_done;
+			pthread_cond_broadcast(&g->done);
+		}
+	}
+	int last = (--g->threads==0);
+	pthread_mutex_unlock(&g->lock);
+	if(last){
+		g->inner->destroy(g->inner);
+		free(g);
+	}
+	return NULL;
+}
+
+/** @brief starts helper thread (lock held) - it blocks all signals, so they still reach search thread. */
+static int guard_spawn(guard_state* g){
+	sigset_t all, old;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	pthread_t thread;
+	int err = pthread_create(&thread, NULL, guard_worker, g);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if(err)
+		return 1;
+	pthread_detach(thread);
+	g->threads++;
+	return 0;
+}
+
+/** @brief decodes octal escapes (\040 etc.) of /proc/self/mounts field in place. */
+static void unescape(char* s){
+	char* out = s;
+	while(*s){
+		if(s[0]=='\\' && s[1]>='0' && s[1]<='7' && s[2]>='0' && s[2]<='7' && s[3]>='0' && s[3]<='7'){
+			*out++ = (s[1]-'0')*64+(s[2]-'0')*8+(s[3]-'0');
+			s += 4;
+		} else {
+			*out++ = *s++;
+		}
+	}
+	*out = 0;
+}
+
+/** @brief finds mount by mount point in old table - degraded state survives reload. */
+static guard_mount* find_mount(guard_mount* mounts, int count, const char* dir){
+	for(int i=0;i<count;i++)
+		if(!strcmp(mounts[i].dir, dir))
+			return mounts+i;
+	return NULL;
+}
+
+static void free_mounts(guard_mount* mounts, int count){
+	for(int i=0;i<count;i++){
+		free(mounts[i].dir);
+		free(mounts[i].type);
+	}
+	free(mounts);
+}
+
+/** @brief Fn reads mount table (mount points and fs types); mounts which come back keep their health. */
+static void guard_load_mounts(guard_state* g){
+	g->mounts_time = guard_now();
+	FILE* f = fopen("/proc/self/mounts", "r");
+	if(!f)
+		return;
+	guard_mount* mounts = NULL;
+	int count = 0, capacity = 0;
+	char* line = NULL;
+	size_t cap = 0;
+	while(getline(&line, &cap, f)>0){
+		char dir[MAX_PATH_LEN], type[64];
+		if(sscanf(line, "%*s %2047s %63s", dir, type)!=2)
+			continue;
+		unescape(dir);
+		if(count==capacity){
+			capacity = capacity ? capacity*2 : 64;
+			guard_mount* tmp = realloc(mounts, sizeof(guard_mount)*capacity);
+			if(!tmp)
+				break;
+			mounts = tmp;
+		}
+		guard_mount* m = mounts+count;
+		guard_mount* old = find_mount(g->mounts, g->mount_count, dir);
+		m->until = old ? old->until : 0;
+		m->backoff = old ? old->backoff : 0;
+		m->len = strlen(dir);
+		m->dir = strdup(dir);
+		m->type = strdup(type);
+		if(!m->dir || !m->type){
+			free(m->dir);
+			free(m->type);
+			break;
+		}
+		count++;
+	}
+	free(line);
+	fclose(f);
+	free_mounts(g->mounts, g->mount_count);
+	g->mounts = mounts;
+	g->mount_count = count;
+}
+
+/** @brief Fn finds mount of path - the longest mount point which is its ancestor (the last one of equal, overmounted ones).
+ * @return mount; NULL if table is empty.
+ */
+static guard_mount* guard_mount_of(guard_state* g, const char* path){
+	if(!g->mounts_time || guard_now()-g->mounts_time>(int64_t) guard_mounts_refresh*1000000000)
+		guard_load_mounts(g);
+	guard_mount* best = NULL;
+	for(int i=0;i<g->mount_count;i++){
+		guard_mount* m = g->mounts+i;
+		if(best && m->len<best->len)
+			continue;
+		if(strncmp(path, m->dir, m->len) || (path[m->len] && path[m->len]!='/' && m->len>1))
+			continue;
+		best = m;
+	}
+	return best;
+}
+
+/** @brief Fn tells if directory lives on degraded mount, which is still in its backoff period. */
+static int guard_degraded(guard_state* g, const char* path){
+	guard_mount* m = guard_mount_of(g, path);
+	return m && m->until>guard_now();
+}
+
+/** @brief Fn marks mount of directory whose thread got stuck in one call as degraded; every next timeout doubles backoff. */
+static void guard_degrade(guard_state* g, const char* path){
+	guard_mount* m = guard_mount_of(g, path);
+	if(!m)
+		return;
+	m->backoff = m->backoff ? m->backoff*2 : guard_backoff_min;
+	if(m->backoff>guard_backoff_max)
+		m->backoff = guard_backoff_max;
+	m->until = guard_now()+(int64_t) m->backoff*1000000000;
+	syslog(LOG_WARNING, "child: %s didn't answer for %d ms - mount %s (%s) degraded, skipped for %d s\n", path, dir_timeout, m->dir, m->type, m->backoff);
+}
+
+/** @brief Fn clears degraded state of mount which answers again after its backoff. */
+static void guard_recovered(guard_state* g, const char* path){
+	guard_mount* m = guard_mount_of(g, path);
+	if(!m || !m->backoff)
+		return;
+	if(verbose)
+		syslog(LOG_INFO, "child: mount %s (%s) answers again\n", m->dir, m->type);
+	m->backoff = 0;
+	m->until = 0;
+}
+
+/** @brief Fn takes queued job out of queue (lock held). */
+static void queue_remove(guard_state* g, guard_job* job){
+	guard_job** p = &g->head;
+	while(*p!=job)
+		p = &(*p)->next;
+	*p = job->next;
+	job->next = NULL;
+	if(g->tail==job){
+		g->tail = NULL;
+		for(guard_job* j=g->head;j;j=j->next)
+			g->tail = j;
+	}
+}
+
+/** @brief Fn puts job into queue (lock held) - reads search waits for go to front, prefetches to back; threads are started by first job.
+ * @return 0 on success; 1 if there's no thread.
+ */
+static int queue_add(guard_state* g, guard_job* job, int front){
+	while(g->threads<guard_threads && !guard_spawn(g))
+		;
+	if(!g->threads)
+		return 1;
+	if(front){
+		job->next = g->head;
+		g->head = job;
+		if(!g->tail)
+			g->tail = job;
+	} else {
+		job->next = NULL;
+		if(g->tail)
+			g->tail->next = job;
+		else
+			g->head = job;
+		g->tail = job;
+	}
+	pthread_cond_signal(&g->work);
+	return 0;
+}
+
+/** @brief Fn puts job right behind prev in queue (lock held), so batch of jobs keeps its order in front of queue; prev which was taken by thread already was ahead of all queued jobs, so job goes to front.
+ * @return 0 on success; 1 if there's no thread.
+ */
+static int queue_add_after(guard_state* g, guard_job* prev, guard_job* job){
+	if(!prev || prev->state!=job_queued)
+		return queue_add(g, job, 1);
+	job->next = prev->next;
+	prev->next = job;
+	if(g->tail==prev)
+		g->tail = job;
+	pthread_cond_signal(&g->work);
+	return 0;
+}
+
+/** @brief Fn drops job nobody waits for (lock held) - running one is freed by its thread. */
+static void guard_drop(guard_state* g, guard_job* job){
+	if(job->state==job_queued){
+		queue_remove(g, job);
+		job_free(job);
+	} else if(job->state==job_running){
+		job->state = job_dropped;
+	} else {
+		job_free(job);
+	}
+}
+
+/** @brief Fn gives up job (lock held) - queued one is dropped, running one is left to its thread, which is replaced. */
+static void guard_abandon(guard_state* g, guard_job* job){
+	if(job->state==job_queued){
+		guard_drop(g, job);
+		return;
+	}
+	job->state = job_abandoned;
+	g->stuck++;
+	if(g->threads-g->stuck<guard_threads && g->threads<guard_threads*guard_max_threads_factor)
+		guard_spawn(g);
+}
+
+static guard_job* job_create(int type, const char* path){
+	guard_job* job = calloc(1, sizeof(guard_job));
+	if(!job)
+		return NULL;
+	job->type = type;
+	snprintf(job->path, MAX_PATH_LEN, "%s", path);
+	return job;
+}
+
+/** @brief Fn waits for job in queue (lock held, released on return) - only while we're scanning, and until job makes no progress for dir_timeout ms.
+ *
+ * Running job gets full timeout again after every call which returned, so only thread stuck inside one call times out. Queued job waits for thread as long as some thread makes progress - only pool where all threads are stuck gives it up.
+ * @return job (done); NULL if it's given up - errno is ETIMEDOUT for timeout (mount is degraded if the job got to thread), EINTR if scan was stopped.
+ */
+static guard_job* guard_wait(guard_state* g, guard_job* job){
+	int64_t end = guard_now()+(int64_t) dir_timeout*1000000;
+	const char* path = job->path;
+	int err = 0;
+	int state = job->state;
+	uint32_t seen = __atomic_load_n(&job->progress, __ATOMIC_RELAXED);
+	uint32_t pool = __atomic_load_n(&g->progress, __ATOMIC_RELAXED);
+	while(job->state!=job_done){
+		int64_t now = guard_now();
+		if(flag!=flag_scan){
+			err = EINTR;
+			break;
+		}
+		uint32_t progress = __atomic_load_n(&job->progress, __ATOMIC_RELAXED);
+		uint32_t pool_progress = __atomic_load_n(&g->progress, __ATOMIC_RELAXED);
+		if(job->state!=state || progress!=seen || (job->state==job_queued && pool_progress!=pool)){
+			state = job->state;
+			seen = progress;
+			pool = pool_progress;
+			end = now+(int64_t) dir_timeout*1000000;
+		}
+		if(now>=end){
+			err = ETIMEDOUT;
+			break;
+		}
+		int64_t wake = now+guard_poll_ms*1000000;
+		if(wake>end)
+			wake = end;
+		struct timespec ts = {wake/1000000000, wake%1000000000};
+		pthread_cond_timedwait(&g->done, &g->lock, &ts);
+	}
+	int started = (job->state==job_running);
+	if(!err){
+		pthread_mutex_unlock(&g->lock);
+		guard_recovered(g, path);
+		return job;
+	}
+	if(err==ETIMEDOUT){
+		if(started){
+			guard_degrade(g, path);
+			snprintf(g->timed_out, MAX_PATH_LEN, "%s", path);
+		} else {/** all threads are stuck - it's not this mount's fault */
+			syslog(LOG_WARNING, "child: no helper thread made progress for %d ms, %s skipped\n", dir_timeout, path);
+		}
+	}
+	/** job (and its path) can be freed right here */
+	guard_abandon(g, job);
+	pthread_mutex_unlock(&g->lock);
+	errno = err;
+	return NULL;
+}
+
+/** @brief Fn hands job to helper threads and waits for it (see guard_wait). */
+static guard_job* guard_run(guard_state* g, int type, const char* path){
+	guard_job* job = job_create(type, path);
+	if(!job){
+		errno = ENOMEM;
+		return NULL;
+	}
+	pthread_mutex_lock(&g->lock);
+	if(queue_add(g, job, 1)){
+		pthread_mutex_unlock(&g->lock);
+		job_free(job);
+		syslog(LOG_ERR, "child: can't start helper threads\n");
+		errno = EAGAIN;
+		return NULL;
+	}
+	return guard_wait(g, job);
+}
+
+/** @brief Fn takes listing of path read ahead by prefetch and waits for it; it's moved to front of queue if it wasn't started yet.
+ * @return job; NULL if path wasn't prefetched (errno 0) or it's given up (errno as guard_wait).
+ */
+static guard_job* guard_prefetched(guard_state* g, const char* path){
+	errno = 0;
+	for(int i=0;i<g->prefetch_count;i++){
+		guard_job* job = g->prefetched[i];
+		if(strcmp(job->path, path))
+			continue;
+		memmove(g->prefetched+i, g->prefetched+i+1, sizeof(guard_job*)*(--g->prefetch_count-i));
+		pthread_mutex_lock(&g->lock);
+		/** search waits for it now - it can take thread left for such jobs */
+		job->prefetch = 0;
+		if(job->state==job_queued){
+			queue_remove(g, job);
+			queue_add(g, job, 1);
+		}
+		return guard_wait(g, job);
+	}
+	return NULL;
+}
+
+/** @brief Fn tells why directory can't be read (errno) - ETIMEDOUT for directory which timed out just now, EHOSTDOWN for others on degraded mount. */
+static int guard_fail(guard_state* g, const char* path){
+	errno = strcmp(path, g->timed_out) ? EHOSTDOWN : ETIMEDOUT;
+	g->timed_out[0] = 0;
+	return -1;
+}
+
+/** @brief access reads whole directory - open_dir of the same path takes the listing. */
+static int guard_access(fs_backend* b, const char* path){
+	guard_state* g = b->data;
+	if(g->pending){
+		job_free(g->pending);
+		g->pending = NULL;
+	}
+	if(guard_degraded(g, path))
+		return guard_fail(g, path);
+	guard_job* job = guard_prefetched(g, path);
+	if(!job && !errno)
+		job = guard_run(g, job_list, path);
+	if(!job){/** errno tells it already */
+		g->timed_out[0] = 0;
+		return -1;
+	}
+	if(job->access_err){
+		errno = job->access_err;
+		job_free(job);
+		return -1;
+	}
+	g->pending = job;
+	return 0;
+}
+
+static fs_dir* guard_open(fs_backend* b, const char* path){
+	guard_state* g = b->data;
+	guard_job* job = g->pending;
+	g->pending = NULL;
+	if(!job || strcmp(job->path, path)){
+		if(job)
+			job_free(job);
+		if(guard_degraded(g, path)){
+			guard_fail(g, path);
+			return NULL;
+		}
+		if(!(job = guard_run(g, job_list, path))){
+			g->timed_out[0] = 0;
+			return NULL;
+		}
+	}
+	if(job->access_err || job->open_err){
+		errno = job->access_err ? job->access_err : job->open_err;
+		job_free(job);
+		return NULL;
+	}
+	return (fs_dir*) job;
+}
+
+static int guard_read(fs_backend* b, fs_dir* dir, fs_entry* entry){
+	guard_job* job = (guard_job*) dir;
+	if(job->pos>=job->len)
+		return 0;
+	entry->type = (unsigned char) job->buf[job->pos];
+	memcpy(&entry->ino, job->buf+job->pos+1, sizeof(uint64_t));
+	entry->name = job->buf+job->pos+1+sizeof(uint64_t);
+	job->pos += 1+sizeof(uint64_t)+strlen(entry->name)+1;
+	return 1;
+}
+
+static void guard_close(fs_backend* b, fs_dir* dir){
+	job_free((guard_job*) dir);
+}
+
+/** @brief stat can hang as well - it's done by helper thread too; 0 (unknown) if it didn't answer. */
+static int64_t guard_mtime(fs_backend* b, const char* path){
+	guard_state* g = b->data;
+	if(guard_degraded(g, path))
+		return 0;
+	guard_job* job = guard_run(g, job_mtime, path);
+	if(!job)
+		return 0;
+	int64_t mtime = job->mtime;
+	job_free(job);
+	return mtime;
+}
+
+/** @brief first block of directory needs its inode - it's read by helper thread too. */
+static uint64_t guard_location(fs_backend* b, const char* path){
+	guard_state* g = b->data;
+	if(guard_degraded(g, path))
+		return 0;
+	guard_job* job = guard_run(g, job_location, path);
+	if(!job)
+		return 0;
+	uint64_t location = job->location;
+	job_free(job);
+	return location;
+}
+
+/** @brief first blocks of all subdirectories of directory are looked up by helper threads at once (in order they're given - inode order), so their inodes are read in parallel, not one blocking lookup after another.
+ *
+ * Search waits as long as lookups keep finishing - at most dir_timeout ms for the next one in order; lookups which didn't finish by then (or when scan is stopped) are given up and their directories stay with unknown location (0).
+ */
+static void guard_locate(fs_backend* b, const char* const* paths, uint64_t* locations, uint32_t count){
+	guard_state* g = b->data;
+	guard_job** jobs = calloc(count, sizeof(guard_job*));
+	for(uint32_t i=0;i<count;i++){
+		locations[i] = 0;
+		if(jobs && !guard_degraded(g, paths[i]))
+			jobs[i] = job_create(job_location, paths[i]);
+	}
+	if(!jobs)
+		return;
+	pthread_mutex_lock(&g->lock);
+	guard_job* prev = NULL;
+	for(uint32_t i=0;i<count;i++){
+		if(!jobs[i])
+			continue;
+		if(queue_add_after(g, prev, jobs[i])){
+			job_free(jobs[i]);
+			jobs[i] = NULL;
+			continue;
+		}
+		prev = jobs[i];
+	}
+	/** lookups run roughly in order - wait for the first unfinished one, every finished one gives next one full timeout */
+	int64_t end = guard_now()+(int64_t) dir_timeout*1000000;
+	uint32_t next = 0;
+	for(;;){
+		uint32_t before = next;
+		while(next<count && (!jobs[next] || jobs[next]->state==job_done))
+			next++;
+		int64_t now = guard_now();
+		if(next!=before)
+			end = now+(int64_t) dir_timeout*1000000;
+		if(next==count || now>=end || flag!=flag_scan)
+			break;
+		int64_t wake = now+guard_poll_ms*1000000;
+		if(wake>end)
+			wake = end;
+		struct timespec ts = {wake/1000000000, wake%1000000000};
+		pthread_cond_timedwait(&g->done, &g->lock, &ts);
+	}
+	for(uint32_t i=0;i<count;i++){
+		if(!jobs[i])
+			continue;
+		if(jobs[i]->state==job_done){
+			locations[i] = jobs[i]->location;
+			job_free(jobs[i]);
+		} else if(jobs[i]->state==job_running){
+			guard_abandon(g, jobs[i]);
+		} else {
+			guard_drop(g, jobs[i]);
+		}
+	}
+	pthread_mutex_unlock(&g->lock);
+	free(jobs);
+}
+
+/** @brief Fn drops all listings read ahead (lock held). */
+static void guard_drop_prefetched(guard_state* g){
+	for(int i=0;i<g->prefetch_count;i++)
+		guard_drop(g, g->prefetched[i]);
+	g->prefetch_count = 0;
+}
+
+/** @brief announced directory is listed by free helper thread ahead of time (at most guard_threads-1 such listings run at once - see queue_next); with guard_prefetch_max hints pending the oldest one (likely pruned or skipped) is dropped. */
+static void guard_prefetch(fs_backend* b, const char* path){
+	guard_state* g = b->data;
+	if(!path){
+		pthread_mutex_lock(&g->lock);
+		guard_drop_prefetched(g);
+		pthread_mutex_unlock(&g->lock);
+		return;
+	}
+	if(guard_degraded(g, path))
+		return;
+	guard_job* job = job_create(job_list, path);
+	if(!job)
+		return;
+	job->prefetch = 1;
+	pthread_mutex_lock(&g->lock);
+	if(g->prefetch_count==guard_prefetch_max){
+		guard_drop(g, g->prefetched[0]);
+		memmove(g->prefetched, g->prefetched+1, sizeof(guard_job*)*--g->prefetch_count);
+	}
+	if(queue_add(g, job, 0))
+		job_free(job);
+	else
+		g->prefetched[g->prefetch_count++] = job;
+	pthread_mutex_unlock(&g->lock);
+}
+
+/** @brief threads stuck in kernel can't be joined - last thread to leave frees state and inner backend. */
+static void guard_destroy(fs_backend* b){
+	guard_state* g = b->data;
+	free(b);
+	if(g->pending)
+		job_free(g->pending);
+	free_mounts(g->mounts, g->mount_count);
+	pthread_mutex_lock(&g->lock);
+	guard_drop_prefetched(g);
+	g->closing = 1;
+	pthread_cond_broadcast(&g->work);
+	int threads = g->threads;
+	pthread_mutex_unlock(&g->lock);
+	if(!threads){
+		g->inner->destroy(g->inner);
+		free(g);
+	}
+}
+
+/** @brief Fn wraps backend with guard (guard takes ownership of inner backend); threads are started by first read, so it can be created before fork.
+ * @return backend; NULL on error.
+ */
+fs_backend* backend_guard(fs_backend* inner){
+	fs_backend* b = calloc(1, sizeof(fs_backend));
+	guard_state* g = calloc(1, sizeof(guard_state));
+	pthread_condattr_t attr;
+	if(!b || !g || pthread_condattr_init(&attr)){
+		free(b);
+		free(g);
+		return NULL;
+	}
+	/** timeouts are measured with monotonic clock - they mustn't jump with wall clock */
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&g->lock, NULL);
+	pthread_cond_init(&g->work, NULL);
+	pthread_cond_init(&g->done, &attr);
+	pthread_condattr_destroy(&attr);
+	g->inner = inner;
+	b->name = inner->name;
+	b->access = guard_access;
+	b->open_dir = guard_open;
+	b->read_dir = guard_read;
+	b->close_dir = guard_close;
+	b->mtime = guard_mtime;
+	b->location = guard_location;
+	b->prefetch = guard_prefetch;
+	b->locate = guard_locate;
+	b->destroy = guard_destroy;
+	b->data = g;
+	return b;
+}
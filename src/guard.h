@@ -0,0 +1,34 @@
+#include <stdint.h>
+#include "backend.h"
+#ifndef FILE_SEEKER_GUARD
+#define FILE_SEEKER_GUARD
+
+/** default count of helper threads reading directories (--dir-threads option) */
+#define guard_default_threads 4
+/** threads stuck in hung mounts are replaced, but there's never more than factor*threads of them */
+#define guard_max_threads_factor 4
+/** how often waiting search checks if it's still scanning (ms) */
+#define guard_poll_ms 20
+/** how long degraded mount is skipped - after first timeout and at most (doubled by every next one), in seconds */
+#define guard_backoff_min 30
+#define guard_backoff_max 3600
+/** max count of directories read ahead (prefetch) at once */
+#define guard_prefetch_max 64
+/** mount table older than this is read again (s) */
+#define guard_mounts_refresh 60
+
+/** @brief mount point with its health - degraded mount is skipped until time in until (CLOCK_MONOTONIC ns). */
+typedef struct guard_mount {
+	char* dir;
+	char* type;
+	size_t len;
+	int64_t until;
+	int backoff;
+} guard_mount;
+
+extern int dir_timeout;
+extern int guard_threads;
+
+fs_backend* backend_guard(fs_backend* inner);
+
+#endif
@@ -0,0 +1,115 @@
+/** @file heat.c
+ *  @brief Directory statistics for hot-first traversal order.
+ *
+ * With -o hot child remembers for every directory how often it had matches, how dense they were and whether its mtime changed between cycles. Every directory gets score from it, and max score of its subtree becomes its priority: next scan visits hot subtrees first (subdirectories are sorted by priority), and cold ones are deferred until all hot subtrees are done. Statistics are kept in memory of child for as long as it searches the same pattern.
+ *  @author Kacper Hącia
+ */
+
+#include "heat.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief traversal order (-o option). */
+int scan_order = order_readdir;
+
+/** @brief time budget of one scan in seconds (-d option); 0 - no budget. */
+int scan_deadline = 0;
+
+/** @brief grows per-node arrays to fit node; new nodes are zeroed. */
+static int heat_reserve(heat_stats* h, uint32_t node){
+	if(node<h->capacity)
+		return 0;
+	uint32_t capacity = h->capacity ? h->capacity : 1024;
+	while(capacity<=node)
+		capacity *= 2;
+	float** floats[] = {&h->heat, &h->density, &h->subtree};
+	for(int i=0;i<3;i++){
+		float* tmp = realloc(*floats[i], sizeof(float)*capacity);
+		if(!tmp)
+			return 1;
+		memset(tmp+h->capacity, 0, sizeof(float)*(capacity-h->capacity));
+		*floats[i] = tmp;
+	}
+	int64_t* tmp = realloc(h->mtime, sizeof(int64_t)*capacity);
+	if(!tmp)
+		return 1;
+	memset(tmp+h->capacity, 0, sizeof(int64_t)*(capacity-h->capacity));
+	h->mtime = tmp;
+	h->capacity = capacity;
+	return 0;
+}
+
+/** @brief Fn initializes empty statistics (root directory only).
+ * @return 0 on success; 1 on error.
+ */
+int heat_init(heat_stats* h){
+	memset(h, 0, sizeof(*h));
+	if(pathstore_init(&h->ps) || heat_reserve(h, pathstore_root)){
+		heat_free(h);
+		return 1;
+	}
+	return 0;
+}
+
+/** @brief Fn frees statistics. */
+void heat_free(heat_stats* h){
+	pathstore_free(&h->ps);
+	free(h->heat);
+	free(h->density);
+	free(h->subtree);
+	free(h->mtime);
+	memset(h, 0, sizeof(*h));
+}
+
+/** @brief Fn finds (or adds) node of subdirectory.
+ * @return node; pathstore_none if parent is pathstore_none or on allocation error.
+ */
+uint32_t heat_dir(heat_stats* h, uint32_t parent, const char* name){
+	if(parent==pathstore_none)
+		return pathstore_none;
+	uint32_t node = pathstore_add(&h->ps, parent, name);
+	if(node==pathstore_none || heat_reserve(h, node))
+		return pathstore_none;
+	return node;
+}
+
+/** @brief Fn gives priority of directory - max score in its subtree from previous scans. */
+float heat_subtree(const heat_stats* h, uint32_t node){
+	return (node==pathstore_none) ? 0 : h->subtree[node];
+}
+
+/** @brief Fn updates statistics of directory after it was listed completely.
+*
+* @param h statistics
+* @param node node of directory
+* @param entries count of entries in directory
+* @param matches count of matching entries
+* @param mtime modification time of directory (ns); 0 if unknown
+* @return new score of directory.
+*/
+float heat_update(heat_stats* h, uint32_t node, uint32_t entries, uint32_t matches, int64_t mtime){
+	if(node==pathstore_none)
+		return matches;
+	/** first scan only records mtime - there's nothing to compare with */
+	float changed = (h->mtime[node] && mtime && mtime!=h->mtime[node]) ? heat_change_bonus : 0;
+	h->heat[node] = h->heat[node]*heat_decay+matches+changed;
+	if(entries)
+		h->density[node] = h->density[node]*(1-heat_density_rate)+heat_density_rate*matches/entries;
+	h->mtime[node] = mtime;
+	return h->heat[node]+heat_density_weight*h->density[node];
+}
+
+/** @brief Fn sets priority of directory. */
+void heat_set_subtree(heat_stats* h, uint32_t node, float subtree){
+	if(node!=pathstore_none)
+		h->subtree[node] = subtree;
+}
+
+/** @brief Fn raises priority of ancestors to priority of node (used for subtrees scanned out of order). */
+void heat_propagate(heat_stats* h, uint32_t node){
+	if(node==pathstore_none)
+		return;
+	float subtree = h->subtree[node];
+	for(uint32_t p=h->ps.parent[node];p!=pathstore_none && h->subtree[p]<subtree;p=h->ps.parent[p])
+		h->subtree[p] = subtree;
+}
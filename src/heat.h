@@ -0,0 +1,41 @@
+#include <stdint.h>
+#include "pathstore.h"
+#include "walk.h"
+#ifndef FILE_SEEKER_HEAT
+#define FILE_SEEKER_HEAT
+
+/** score decay per scan of directory (recent matches and mtime changes fade out) */
+#define heat_decay 0.5f
+/** weight of one mtime change of directory, compared to one match in it */
+#define heat_change_bonus 0.5f
+/** how fast match density follows last scans, and its weight in score */
+#define heat_density_rate 0.25f
+#define heat_density_weight 4.0f
+/** subtrees with score below are cold */
+#define heat_epsilon 0.01f
+
+/** @brief directory statistics kept between scan cycles - path store nodes with per-node counters.
+*
+* score of directory is heat (decayed count of matches and mtime changes) plus weighted match density; subtree is max score of directory and all its known subdirectories - it's the priority of directory in hot-first order.
+*/
+typedef struct heat_stats {
+	pathstore ps;
+	float* heat;
+	float* density;
+	float* subtree;
+	int64_t* mtime;
+	uint32_t capacity;
+} heat_stats;
+
+extern int scan_order;
+extern int scan_deadline;
+
+int heat_init(heat_stats* h);
+void heat_free(heat_stats* h);
+uint32_t heat_dir(heat_stats* h, uint32_t parent, const char* name);
+float heat_subtree(const heat_stats* h, uint32_t node);
+float heat_update(heat_stats* h, uint32_t node, uint32_t entries, uint32_t matches, int64_t mtime);
+void heat_set_subtree(heat_stats* h, uint32_t node, float subtree);
+void heat_propagate(heat_stats* h, uint32_t node);
+
+#endif
@@ -0,0 +1,225 @@
+/** @file matcher.c
+ *  @brief Name matching strategies - strstr, Aho-Corasick automaton, SIMD and glob.
+ *
+ * Matching name against patterns is the hot path of scan - it runs for every directory entry. Strategy is chosen with -m option (measured with bench/matchbench), all of them answer the same question: index of first pattern which is substring of name (glob one treats pattern as glob).
+ *  @author Kacper Hącia
+ */
+
+#include "matcher.h"
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/** @brief names of strategies for -m option and reports. */
+static const char* const matcher_names[matcher_kinds] = {"strstr", "ac", "simd", "glob"};
+
+/** @brief Fn names strategy. */
+const char* matcher_name(int kind){
+	return (kind>=0 && kind<matcher_kinds) ? matcher_names[kind] : "unknown";
+}
+
+/** @brief Fn maps strategy name to its id.
+ * @return strategy; -1 if name is unknown.
+ */
+int matcher_parse(const char* name){
+	for(int i=0;i<matcher_kinds;i++)
+		if(!strcmp(name, matcher_names[i]))
+			return i;
+	return -1;
+}
+
+/** @brief builds Aho-Corasick automaton with dense transitions (goto + fail folded into next). */
+static int build_ac(matcher* m){
+	int max = 1;
+	for(int i=0;i<m->count;i++)
+		max += m->lengths[i];
+	m->next = malloc(sizeof(*m->next)*max);
+	m->out = malloc(sizeof(int32_t)*max);
+	m->dict = malloc(sizeof(int32_t)*max);
+	int32_t* fail = malloc(sizeof(int32_t)*max);
+	int32_t* queue = malloc(sizeof(int32_t)*max);
+	if(!m->next || !m->out || !m->dict || !fail || !queue){
+		free(fail);
+		free(queue);
+		return 1;
+	}
+	/** trie; -1 - no edge yet */
+	memset(m->next, 0xff, sizeof(*m->next));
+	m->out[0] = -1;
+	m->states = 1;
+	for(int i=0;i<m->count;i++){
+		int s = 0;
+		for(size_t j=0;j<m->lengths[i];j++){
+			unsigned char c = m->patterns[i][j];
+			if(m->next[s][c]<0){
+				memset(m->next[m->states], 0xff, sizeof(*m->next));
+				m->out[m->states] = -1;
+				m->next[s][c] = m->states++;
+			}
+			s = m->next[s][c];
+		}
+		/** duplicate pattern keeps lower index */
+		if(m->out[s]<0)
+			m->out[s] = i;
+	}
+	/** BFS - fail links, dictionary links (nearest state on fail chain with output) and dense transitions */
+	int head = 0, tail = 0;
+	for(int c=0;c<256;c++){
+		if(m->next[0][c]<0){
+			m->next[0][c] = 0;
+		} else {
+			fail[m->next[0][c]] = 0;
+			queue[tail++] = m->next[0][c];
+		}
+	}
+	m->dict[0] = -1;
+	while(head<tail){
+		int s = queue[head++];
+		m->dict[s] = (m->out[fail[s]]>=0) ? fail[s] : m->dict[fail[s]];
+		for(int c=0;c<256;c++){
+			int t = m->next[s][c];
+			if(t<0){
+				m->next[s][c] = m->next[fail[s]][c];
+			} else {
+				fail[t] = m->next[fail[s]][c];
+				queue[tail++] = t;
+			}
+		}
+	}
+	free(fail);
+	free(queue);
+	return 0;
+}
+
+/** @brief Fn compiles pattern set for given strategy (patterns are copied).
+ * @return matcher; NULL on error.
+ */
+matcher* matcher_create(int kind, char* const* patterns, int count){
+	matcher* m = calloc(1, sizeof(matcher));
+	if(!m)
+		return NULL;
+	m->kind = kind;
+	m->count = count;
+	m->patterns = calloc(count, sizeof(char*));
+	m->lengths = calloc(count, sizeof(size_t));
+	if(!m->patterns || !m->lengths){
+		matcher_free(m);
+		return NULL;
+	}
+	for(int i=0;i<count;i++){
+		if(!(m->patterns[i] = strdup(patterns[i]))){
+			matcher_free(m);
+			return NULL;
+		}
+		m->lengths[i] = strlen(patterns[i]);
+	}
+	if(kind==matcher_ac && build_ac(m)){
+		matcher_free(m);
+		return NULL;
+	}
+	if(kind==matcher_glob){
+		if(!(m->globs = calloc(count, sizeof(char*)))){
+			matcher_free(m);
+			return NULL;
+		}
+		for(int i=0;i<count;i++){
+			if(!(m->globs[i] = malloc(m->lengths[i]+3))){
+				matcher_free(m);
+				return NULL;
+			}
+			sprintf(m->globs[i], "*%s*", patterns[i]);
+		}
+	}
+	return m;
+}
+
+/** @brief Fn frees matcher. */
+void matcher_free(matcher* m){
+	if(!m)
+		return;
+	for(int i=0;i<m->count;i++){
+		if(m->patterns)
+			free(m->patterns[i]);
+		if(m->globs)
+			free(m->globs[i]);
+	}
+	free(m->patterns);
+	free(m->globs);
+	free(m->lengths);
+	free(m->next);
+	free(m->out);
+	free(m->dict);
+	free(m);
+}
+
+/** @brief substring search of one pattern - SSE2 first/last byte filter, scalar tail. */
+static int simd_find(const char* name, size_t len, const char* pattern, size_t plen){
+	if(plen==0)
+		return 1;
+	if(plen>len)
+		return 0;
+	size_t i = 0;
+	size_t last = len-plen;
+#ifdef __SSE2__
+	const __m128i first_byte = _mm_set1_epi8(pattern[0]);
+	const __m128i last_byte = _mm_set1_epi8(pattern[plen-1]);
+	/** block at i covers start positions i..i+15; its last-byte load must stay inside name */
+	for(;i+15<=last;i+=16){
+		__m128i f = _mm_loadu_si128((const __m128i*) (name+i));
+		__m128i l = _mm_loadu_si128((const __m128i*) (name+i+plen-1));
+		unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(f, first_byte), _mm_cmpeq_epi8(l, last_byte)));
+		while(mask){
+			int bit = __builtin_ctz(mask);
+			if(memcmp(name+i+bit+1, pattern+1, plen>2 ? plen-2 : 0)==0)
+				return 1;
+			mask &= mask-1;
+		}
+	}
+#endif
+	for(;i<=last;i++)
+		if(name[i]==pattern[0] && name[i+plen-1]==pattern[plen-1] && memcmp(name+i, pattern, plen)==0)
+			return 1;
+	return 0;
+}
+
+/** @brief Fn matches name against pattern set.
+*
+* @param m compiled matcher
+* @param name name to check (null-terminated)
+* @param len length of name
+* @return index of first pattern found in name (for ac - of pattern which ends first); -1 if none.
+*/
+int matcher_match(const matcher* m, const char* name, size_t len){
+	switch (m->kind) {
+		case matcher_ac: {
+			int32_t s = 0;
+			for(size_t i=0;i<len;i++){
+				s = m->next[s][(unsigned char) name[i]];
+				if(m->out[s]>=0)
+					return m->out[s];
+				if(m->dict[s]>=0)
+					return m->out[m->dict[s]];
+			}
+			return -1;
+		}
+		case matcher_simd:
+			for(int i=0;i<m->count;i++)
+				if(simd_find(name, len, m->patterns[i], m->lengths[i]))
+					return i;
+			return -1;
+		case matcher_glob:
+			for(int i=0;i<m->count;i++)
+				if(fnmatch(m->globs[i], name, 0)==0)
+					return i;
+			return -1;
+		default:
+			for(int i=0;i<m->count;i++)
+				if(strstr(name, m->patterns[i]))
+					return i;
+			return -1;
+	}
+}
@@ -0,0 +1,35 @@
+#include <stddef.h>
+#include <stdint.h>
+#ifndef FILE_SEEKER_MATCHER
+#define FILE_SEEKER_MATCHER
+
+/** matching strategies */
+#define matcher_strstr 0
+#define matcher_ac 1
+#define matcher_simd 2
+#define matcher_glob 3
+#define matcher_kinds 4
+
+/** @brief compiled set of patterns; every strategy answers "which pattern is substring of name".
+*
+* ac is Aho-Corasick automaton with dense (256 wide) transition table - one table step per byte for all patterns together. simd compares first and last byte of pattern on 16 positions at once (SSE2; scalar fallback elsewhere). glob matches patterns with fnmatch as *pattern*, so they may contain glob wildcards.
+*/
+typedef struct matcher {
+	int kind;
+	int count;
+	char** patterns;
+	size_t* lengths;
+	char** globs;
+	int32_t (*next)[256];
+	int32_t* out;
+	int32_t* dict;
+	int states;
+} matcher;
+
+const char* matcher_name(int kind);
+int matcher_parse(const char* name);
+matcher* matcher_create(int kind, char* const* patterns, int count);
+int matcher_match(const matcher* m, const char* name, size_t len);
+void matcher_free(matcher* m);
+
+#endif
@@ -0,0 +1,318 @@
+/** @file pathstore.c
+ *  @brief Compact in-memory store of scanned paths.
+ *
+ * Keeping full path string (up to MAX_PATH_LEN) for every scanned entry costs hundreds of bytes per entry. Path store keeps tree instead: every node is pair of 32-bit parent index and 32-bit name id in two parallel arrays, and names are interned - node_modules, index.js or __init__.py are stored once no matter how many times they occur. Two open addressing hash tables (name -> id and (parent, name) -> node) make interning and child lookup O(1). Full path is rebuilt only when somebody asks for it, by walking parents up to root.
+ *  @author Kacper Hącia
+ */
+
+#include "pathstore.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief FNV-1a hash of name with given length. */
+static uint32_t hash_name(const char* name, size_t len){
+	uint32_t h = 2166136261u;
+	for(size_t i=0;i<len;i++){
+		h ^= (unsigned char) name[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/** @brief hash of (parent, name id) pair. */
+static uint32_t hash_node(uint32_t parent, uint32_t name){
+	uint64_t key = ((uint64_t) parent << 32) | name;
+	key *= 0x9e3779b97f4a7c15ull;
+	return (uint32_t) (key >> 32);
+}
+
+/** @brief allocates bucket array filled with pathstore_none. */
+static uint32_t* buckets_alloc(uint32_t count){
+	uint32_t* b = malloc(sizeof(uint32_t)*count);
+	if(b)
+		memset(b, 0xff, sizeof(uint32_t)*count);
+	return b;
+}
+
+/** @brief finds id of name with given length; pathstore_none if not interned. */
+static uint32_t name_find(const name_table* t, const char* name, size_t len, uint32_t h){
+	uint32_t mask = t->bucket_count-1;
+	for(uint32_t i=h & mask;;i=(i+1) & mask){
+		uint32_t id = t->buckets[i];
+		if(id==pathstore_none)
+			return pathstore_none;
+		const char* s = t->chars+t->offsets[id];
+		if(strncmp(s, name, len)==0 && s[len]==0)
+			return id;
+	}
+}
+
+/** @brief doubles name hash table. */
+static int name_rehash(name_table* t){
+	uint32_t count = t->bucket_count*2;
+	uint32_t* b = buckets_alloc(count);
+	if(!b)
+		return 1;
+	for(uint32_t id=0;id<t->count;id++){
+		const char* s = t->chars+t->offsets[id];
+		uint32_t i = hash_name(s, strlen(s)) & (count-1);
+		while(b[i]!=pathstore_none)
+			i = (i+1) & (count-1);
+		b[i] = id;
+	}
+	free(t->buckets);
+	t->buckets = b;
+	t->bucket_count = count;
+	return 0;
+}
+
+/** @brief interns name with given length.
+ * @return name id; pathstore_none on allocation error.
+ */
+static uint32_t name_intern(name_table* t, const char* name, size_t len){
+	uint32_t h = hash_name(name, len);
+	uint32_t id = name_find(t, name, len, h);
+	if(id!=pathstore_none)
+		return id;
+	if(t->count==t->capacity){
+		uint32_t capacity = t->capacity*2;
+		uint32_t* tmp = realloc(t->offsets, sizeof(uint32_t)*capacity);
+		if(!tmp)
+			return pathstore_none;
+		t->offsets = tmp;
+		t->capacity = capacity;
+	}
+	if(t->chars_len+len+1>t->chars_capacity){
+		size_t capacity = t->chars_capacity*2;
+		while(capacity<t->chars_len+len+1)
+			capacity *= 2;
+		char* tmp = realloc(t->chars, capacity);
+		if(!tmp)
+			return pathstore_none;
+		t->chars = tmp;
+		t->chars_capacity = capacity;
+	}
+	if((t->count+1)*2>t->bucket_count && name_rehash(t))
+		return pathstore_none;
+	id = t->count++;
+	t->offsets[id] = t->chars_len;
+	memcpy(t->chars+t->chars_len, name, len);
+	t->chars[t->chars_len+len] = 0;
+	t->chars_len += len+1;
+	uint32_t mask = t->bucket_count-1;
+	uint32_t i = h & mask;
+	while(t->buckets[i]!=pathstore_none)
+		i = (i+1) & mask;
+	t->buckets[i] = id;
+	return id;
+}
+
+/** @brief Fn initializes store with root node only.
+ * @return 0 on success; 1 on allocation error.
+ */
+int pathstore_init(pathstore* ps){
+	memset(ps, 0, sizeof(*ps));
+	name_table* t = &ps->names;
+	t->chars_capacity = 4096;
+	t->capacity = 1024;
+	t->bucket_count = 2048;
+	ps->capacity = 1024;
+	ps->bucket_count = 2048;
+	t->chars = malloc(t->chars_capacity);
+	t->offsets = malloc(sizeof(uint32_t)*t->capacity);
+	t->buckets = buckets_alloc(t->bucket_count);
+	ps->parent = malloc(sizeof(uint32_t)*ps->capacity);
+	ps->name = malloc(sizeof(uint32_t)*ps->capacity);
+	ps->buckets = buckets_alloc(ps->bucket_count);
+	if(!t->chars || !t->offsets || !t->buckets || !ps->parent || !ps->name || !ps->buckets){
+		pathstore_free(ps);
+		return 1;
+	}
+	/** root has empty name and no parent; it's not in child hash */
+	ps->parent[0] = pathstore_none;
+	ps->name[0] = name_intern(t, "", 0);
+	ps->count = 1;
+	return 0;
+}
+
+/** @brief Fn frees store. */
+void pathstore_free(pathstore* ps){
+	free(ps->names.chars);
+	free(ps->names.offsets);
+	free(ps->names.buckets);
+	free(ps->parent);
+	free(ps->name);
+	free(ps->buckets);
+	memset(ps, 0, sizeof(*ps));
+}
+
+/** @brief Fn interns name.
+ * @return name id; pathstore_none on error.
+ */
+uint32_t pathstore_intern(pathstore* ps, const char* name){
+	return name_intern(&ps->names, name, strlen(name));
+}
+
+/** @brief Fn returns (interned) name of node. */
+const char* pathstore_name(const pathstore* ps, uint32_t node){
+	return ps->names.chars+ps->names.offsets[ps->name[node]];
+}
+
+/** @brief finds child of parent with name id. */
+static uint32_t child_find(const pathstore* ps, uint32_t parent, uint32_t name){
+	uint32_t mask = ps->bucket_count-1;
+	for(uint32_t i=hash_node(parent, name) & mask;;i=(i+1) & mask){
+		uint32_t node = ps->buckets[i];
+		if(node==pathstore_none || (ps->parent[node]==parent && ps->name[node]==name))
+			return node;
+	}
+}
+
+/** @brief finds child of parent by name with given length. */
+static uint32_t child_find_name(const pathstore* ps, uint32_t parent, const char* name, size_t len){
+	uint32_t id = name_find(&ps->names, name, len, hash_name(name, len));
+	if(id==pathstore_none)
+		return pathstore_none;
+	return child_find(ps, parent, id);
+}
+
+/** @brief Fn finds child of parent node by name.
+ * @return node; pathstore_none if there's no such child.
+ */
+uint32_t pathstore_child(const pathstore* ps, uint32_t parent, const char* name){
+	return child_find_name(ps, parent, name, strlen(name));
+}
+
+/** @brief doubles child hash table. */
+static int node_rehash(pathstore* ps){
+	uint32_t count = ps->bucket_count*2;
+	uint32_t* b = buckets_alloc(count);
+	if(!b)
+		return 1;
+	for(uint32_t node=1;node<ps->count;node++){
+		uint32_t i = hash_node(ps->parent[node], ps->name[node]) & (count-1);
+		while(b[i]!=pathstore_none)
+			i = (i+1) & (count-1);
+		b[i] = node;
+	}
+	free(ps->buckets);
+	ps->buckets = b;
+	ps->bucket_count = count;
+	return 0;
+}
+
+/** @brief adds child with name of given length (or returns existing one). */
+static uint32_t add_name(pathstore* ps, uint32_t parent, const char* name, size_t len){
+	uint32_t id = name_intern(&ps->names, name, len);
+	if(id==pathstore_none)
+		return pathstore_none;
+	uint32_t node = child_find(ps, parent, id);
+	if(node!=pathstore_none)
+		return node;
+	if(ps->count==pathstore_none-1)
+		return pathstore_none;
+	if(ps->count==ps->capacity){
+		uint32_t capacity = ps->capacity*2;
+		uint32_t* p = realloc(ps->parent, sizeof(uint32_t)*capacity);
+		if(!p)
+			return pathstore_none;
+		ps->parent = p;
+		uint32_t* n = realloc(ps->name, sizeof(uint32_t)*capacity);
+		if(!n)
+			return pathstore_none;
+		ps->name = n;
+		ps->capacity = capacity;
+	}
+	if((ps->count+1)*2>ps->bucket_count && node_rehash(ps))
+		return pathstore_none;
+	node = ps->count++;
+	ps->parent[node] = parent;
+	ps->name[node] = id;
+	uint32_t mask = ps->bucket_count-1;
+	uint32_t i = hash_node(parent, id) & mask;
+	while(ps->buckets[i]!=pathstore_none)
+		i = (i+1) & mask;
+	ps->buckets[i] = node;
+	return node;
+}
+
+/** @brief Fn adds child of parent node (or returns existing one).
+ * @return node; pathstore_none on error.
+ */
+uint32_t pathstore_add(pathstore* ps, uint32_t parent, const char* name){
+	return add_name(ps, parent, name, strlen(name));
+}
+
+/** @brief Fn finds node of absolute path ("/usr/lib"); repeated and trailing slashes are ignored.
+ * @return node; pathstore_none if path isn't in store.
+ */
+uint32_t pathstore_lookup(const pathstore* ps, const char* path){
+	uint32_t node = pathstore_root;
+	while(*path && node!=pathstore_none){
+		while(*path=='/')
+			path++;
+		size_t len = strcspn(path, "/");
+		if(len)
+			node = child_find_name(ps, node, path, len);
+		path += len;
+	}
+	return node;
+}
+
+/** @brief Fn adds absolute path with all missing ancestors.
+ * @return node of path; pathstore_none on error.
+ */
+uint32_t pathstore_insert(pathstore* ps, const char* path){
+	uint32_t node = pathstore_root;
+	while(*path && node!=pathstore_none){
+		while(*path=='/')
+			path++;
+		size_t len = strcspn(path, "/");
+		if(len)
+			node = add_name(ps, node, path, len);
+		path += len;
+	}
+	return node;
+}
+
+/** @brief Fn rebuilds full path of node.
+*
+* Path is truncated if buf is too small, but it's always null-terminated (if len>0).
+* @return length of full path (like snprintf).
+*/
+size_t pathstore_path(const pathstore* ps, uint32_t node, char* buf, size_t len){
+	if(node==pathstore_root){
+		if(len>1)
+			strcpy(buf, "/");
+		else if(len)
+			*buf = 0;
+		return 1;
+	}
+	/** first pass - total length; second pass - fill from the end */
+	size_t total = 0;
+	for(uint32_t n=node;n!=pathstore_root;n=ps->parent[n])
+		total += 1+strlen(pathstore_name(ps, n));
+	if(!len)
+		return total;
+	size_t end = total<len ? total : len-1;
+	buf[end] = 0;
+	size_t pos = total;
+	for(uint32_t n=node;n!=pathstore_root;n=ps->parent[n]){
+		const char* name = pathstore_name(ps, n);
+		size_t l = strlen(name);
+		pos -= l+1;
+		for(size_t i=0;i<=l;i++){
+			size_t at = pos+i;
+			if(at<end)
+				buf[at] = i ? name[i-1] : '/';
+		}
+	}
+	return total;
+}
+
+/** @brief Fn returns number of bytes allocated by store. */
+size_t pathstore_bytes(const pathstore* ps){
+	const name_table* t = &ps->names;
+	return sizeof(*ps) + t->chars_capacity + sizeof(uint32_t)*(t->capacity+t->bucket_count)
+		+ sizeof(uint32_t)*(2*(size_t)ps->capacity+ps->bucket_count);
+}
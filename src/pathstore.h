@@ -0,0 +1,51 @@
+#include <stdint.h>
+#include <stddef.h>
+#ifndef FILE_SEEKER_PATHSTORE
+#define FILE_SEEKER_PATHSTORE
+
+/** "no node"/"no name" value; parent of root node */
+#define pathstore_none UINT32_MAX
+/** root node ("/") is always node 0 */
+#define pathstore_root 0
+
+/** @brief interned names - every distinct name is stored once in character arena.
+*
+*
+*/
+typedef struct name_table {
+	char* chars;
+	size_t chars_len;
+	size_t chars_capacity;
+	uint32_t* offsets;
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t* buckets;
+	uint32_t bucket_count;
+} name_table;
+
+/** @brief compact tree of paths - node is (parent node, name id) pair kept in two parallel arrays.
+*
+* Full path of node is rebuilt on demand by walking parents. (parent, name) -> node hash makes child lookup O(1).
+*/
+typedef struct pathstore {
+	name_table names;
+	uint32_t* parent;
+	uint32_t* name;
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t* buckets;
+	uint32_t bucket_count;
+} pathstore;
+
+int pathstore_init(pathstore* ps);
+void pathstore_free(pathstore* ps);
+uint32_t pathstore_intern(pathstore* ps, const char* name);
+const char* pathstore_name(const pathstore* ps, uint32_t node);
+uint32_t pathstore_child(const pathstore* ps, uint32_t parent, const char* name);
+uint32_t pathstore_add(pathstore* ps, uint32_t parent, const char* name);
+uint32_t pathstore_lookup(const pathstore* ps, const char* path);
+uint32_t pathstore_insert(pathstore* ps, const char* path);
+size_t pathstore_path(const pathstore* ps, uint32_t node, char* buf, size_t len);
+size_t pathstore_bytes(const pathstore* ps);
+
+#endif
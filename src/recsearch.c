@@ -1,124 +1,395 @@
 /** @file recsearch.c
  *  @brief Recursive search driver.
  *
- * Wrapper function gets offset and sets pointer to searched substring. Then it's calling root function, which calls normal recursive function. Inside them, program checks for access and opens dir (if dir and has access). Then it uses strstr to check if searched word is in file/dir name. If yes, it will log it.
+ * Wrapper function gets offset and sets pointer to searched substring. Then it's calling recursive function for "/" (in hot-first order, -o hot, hottest subtrees from previous cycles go first). Inside it, program checks for access and opens dir (if dir and has access) through traversal backend. Then it uses strstr to check if searched word is in file/dir name. If yes, it will log it.
  *  @author Kacper Hącia
  */
 
 #include "fileseeker.h"
+#include <errno.h>
 
-/** @brief recursive function for finding word in file names in given dir.
+/** @brief traversal of this child - compiled pattern (strategy from -m option) with its limit; rebuilt when pattern changes. */
+static walk_ctx walk;
+static int walk_ready = 0;
+
+/** reasons of scan cut short by itself */
+#define cut_none 0
+#define cut_deadline 1
+#define cut_limit 2
+
+/** @brief end of time budget of current scan (-d option) and why scan was cut short. */
+static struct timespec deadline;
+static int scan_cut = cut_none;
+
+/** @brief match limit of pattern (counted by traversal core). */
+static int scan_limit = limit_none;
+
+/** @brief 1 if last search_rec searched its whole subtree - scan with time budget lists such subtrees as covered by partial results. */
+static int subtree_done = 0;
+/** @brief 1 if last search_rec added complete summary of its subtree to summary of its parent. */
+static int subtree_summarized = 0;
+
+/** @brief logs found file or directory and passes it to snapshot export.
  *
- * @param word_to_find char* of word we want to find (pattern)
- * @param root_path our directory
+ * @param path full path of found file/directory
+ * @param word_to_find pattern which matched
+ * @param is_dir 1 for directory, 0 for file
  */
-void search_rec(char* word_to_find, char *root_path) {
-	if(flag==flag_scan){/** as long as we're in state of scanning */
-		DIR *dir;
-		struct dirent *entry;
-		//struct stat s;
-
-		/** check access - if we don't have permissions, return. */
-		if (access(root_path, R_OK) != 0) {
-			return;
-		}
+void report_match(const char* path, const char* word_to_find, int is_dir){
+	time_t t = time(NULL);
+	struct tm tm = *localtime(&t);
+	syslog(LOG_INFO ,"found %s: date: %d-%02d-%02d %02d:%02d:%02d full_path: %s pattern: %s\n", is_dir ? "directory" : "file", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, path, word_to_find);
+	export_match(path, is_dir);
+	trace_emit(trace_match, is_dir, path, 0, 0, 0);
+}
 
-		/** let's try open dir - if we don't have permissions, return. */
-		if (!(dir = opendir(root_path)))
-			return;
+/** @brief statistics of directories for hot-first order (-o hot); reset when pattern changes. */
+static heat_stats heat;
+static int heat_ready = 0;
+
+/** @brief trigram summaries of subtrees for pruning (-P option); shared by all children. */
+static summary_set summaries;
+static int summaries_ready = 0;
+
+/** @brief whether current scan prunes subtrees (every prune_rescan-th scan is full) and its counters. */
+static int pruning = 0;
+static uint32_t dirs_visited = 0;
+static uint32_t dirs_pruned = 0;
+
+/** @brief directory being listed, as seen by hooks of traversal - its node in heat statistics, key in summaries and summary being built (NULL if there's none). */
+typedef struct search_dir {
+	uint32_t node;
+	uint64_t skey;
+	uint64_t* bits;
+} search_dir;
+
+/** @brief cold subtree deferred by first (hot) pass. */
+typedef struct deferred_dir {
+	char* path;
+	uint32_t node;
+	uint64_t skey;
+} deferred_dir;
 
-		char* path = malloc(MAX_PATH_LEN*sizeof(char));
-
-		while ((entry = readdir(dir)) != NULL && flag==flag_scan) {/** as long as we have dir to analyse we're in state of scanning */
-		        //char path[1024];
-		        snprintf(path, MAX_PATH_LEN, "%s/%s", root_path, entry->d_name);/** concatenate strings */
-
-		        if (entry->d_type == DT_DIR) {
-				if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) /** check for . and .. dirs; ignore them - continue. */
-					continue;
-				if(verbose>1)/** if verbose, print info about comparation */
-					syslog(LOG_INFO ,"dir compare: dir_name %s searched_pattern %s in %s \n", entry->d_name, word_to_find, root_path);
-				if (strstr(entry->d_name, word_to_find) != NULL) {/** if word_to_find is in our dir name, log it. */
-					time_t t = time(NULL);
-					struct tm tm = *localtime(&t);
-					syslog(LOG_INFO ,"found directory: date: %d-%02d-%02d %02d:%02d:%02d full_path: %s pattern: %s\n",tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, path, word_to_find);
-				}
-				search_rec(word_to_find, path);
-			} else if (entry->d_type == DT_REG) {
-				if(verbose>1){/** if verbose, print info about comparation */
-					syslog(LOG_INFO ,"file compare: file_name %s searched_pattern %s in %s \n", entry->d_name, word_to_find, root_path);
-				}
-				if (strstr(entry->d_name, word_to_find) != NULL) {/** if wor_to_find is in our file name, log it. */
-					time_t t = time(NULL);
-					struct tm tm = *localtime(&t);
-					syslog(LOG_INFO ,"found file: date: %d-%02d-%02d %02d:%02d:%02d full_path: %s pattern: %s\n",tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, path, word_to_find);
-				}
-			}
+static deferred_dir* deferred = NULL;
+static size_t deferred_count = 0;
+static size_t deferred_capacity = 0;
+
+/** @brief Fn tells if scan should go on - we're scanning, pattern isn't satisfied and time budget isn't spent (clock is checked once per directory). */
+static int scanning(){
+	if(flag!=flag_scan || scan_cut)
+		return 0;
+	if(scan_deadline){
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if(now.tv_sec>deadline.tv_sec || (now.tv_sec==deadline.tv_sec && now.tv_nsec>=deadline.tv_nsec)){
+			scan_cut = cut_deadline;
+			return 0;
 		}
-		closedir(dir);
-		free(path);
 	}
+	return 1;
 }
 
-/** @brief see search_rec; minor change.
- * function for only "/" directory - it changes %s/%s in contencation of root dir and new found dir/file to avoid //home... notation - for docs check fn search_rec.
- */
-void search_rec_root(char* word_to_find, char *root_path) {
-	if(flag==flag_scan){
-		DIR *dir;
-		struct dirent *entry;
-		//struct stat s;
+/** @brief hook - listing ends when scan is stopped or pattern is satisfied. */
+static int search_stopped(void* arg){
+	return flag!=flag_scan || scan_cut;
+}
 
-		if (access(root_path, R_OK) != 0) {
-			return;
-		}
+/** @brief hook - every name goes into summary being built; if verbose, info about comparation is logged (with tracing on, trace replaces it). */
+static void search_name(void* arg, void* dir, const char* root_path, const char* name, int is_dir){
+	search_dir* d = dir;
+	if(d->bits)
+		summary_add_name(d->bits, name, strlen(name));
+	if(verbose>1 && !trace)
+		syslog(LOG_INFO ,"%s compare: %s_name %s searched_pattern %s in %s \n", is_dir ? "dir" : "file", is_dir ? "dir" : "file", name, (const char*) arg, root_path);
+}
+
+/** @brief hook - match is logged and exported. */
+static void search_match(void* arg, void* dir, const char* path, int pattern, int is_dir){
+	report_match(path, arg, is_dir);
+}
 
-		if (!(dir = opendir(root_path)))
+/** @brief hook - pattern is satisfied, stop scan. */
+static void search_satisfied(void* arg){
+	scan_cut = cut_limit;
+}
+
+/** @brief hook - subdirectory gets its node in heat statistics (with its priority) and its key in summaries. */
+static void search_subdir(void* arg, void* dir, walk_subdir* s){
+	search_dir* d = dir;
+	s->node = heat_dir(&heat, d->node, s->name);
+	s->key = summary_dir(&summaries, d->skey, s->name);
+	s->priority = heat_subtree(&heat, s->node);
+}
+
+/** @brief Fn defers cold subtree to second pass. */
+static void defer_dir(const char* path, uint32_t node, uint64_t skey){
+	if(deferred_count==deferred_capacity){
+		size_t capacity = deferred_capacity ? deferred_capacity*2 : 256;
+		deferred_dir* tmp = realloc(deferred, sizeof(deferred_dir)*capacity);
+		if(!tmp)
 			return;
+		deferred = tmp;
+		deferred_capacity = capacity;
+	}
+	if((deferred[deferred_count].path = strdup(path))){
+		deferred[deferred_count].skey = skey;
+		deferred[deferred_count++].node = node;
+	}
+}
 
-		char* path = malloc(MAX_PATH_LEN*sizeof(char));
-
-		while ((entry = readdir(dir)) != NULL && flag==flag_scan) {
-		        //char path[1024];
-		        snprintf(path, MAX_PATH_LEN, "/%s", entry->d_name);
-
-		        if (entry->d_type == DT_DIR) {
-				if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-					continue;
-				if(verbose>1)
-					syslog(LOG_INFO ,"dir compare: dir_name %s searched_pattern %s in %s \n", entry->d_name, word_to_find, root_path);
-				if (strstr(entry->d_name, word_to_find) != NULL) {
-					time_t t = time(NULL);
-					struct tm tm = *localtime(&t);
-					syslog(LOG_INFO ,"found directory: date: %d-%02d-%02d %02d:%02d:%02d full_path: %s pattern: %s\n",tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, path, word_to_find);
-				}
-				search_rec(word_to_find, path);
-			} else if (entry->d_type == DT_REG) {
-				if(verbose>1){
-					syslog(LOG_INFO ,"file compare: file_name %s searched_pattern %s in %s \n", entry->d_name, word_to_find, root_path);
-				}
-				if (strstr(entry->d_name, word_to_find) != NULL) {
-					time_t t = time(NULL);
-					struct tm tm = *localtime(&t);
-					syslog(LOG_INFO ,"found file: date: %d-%02d-%02d %02d:%02d:%02d full_path: %s pattern: %s\n",tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, path, word_to_find);
-				}
-			}
-		}
-		closedir(dir);
-		free(path);
+/** @brief Fn tells why directory couldn't be read - guard backend (-D option) sets errno to ETIMEDOUT or EHOSTDOWN (degraded mount). */
+static int skip_reason(int reason){
+	if(errno==ETIMEDOUT)
+		return trace_skip_timeout;
+	if(errno==EHOSTDOWN)
+		return trace_skip_degraded;
+	return reason;
+}
+
+/** @brief Fn decides if subdirectory can be skipped - its summary can't contain pattern and it didn't change since summary was built. */
+static int prune_dir(const char* path, uint64_t skey){
+	int64_t built;
+	if(!pruning || summary_may_match(&summaries, skey, &built))
+		return 0;
+	if(backend->mtime(backend, path)!=built)
+		return 0;
+	dirs_pruned++;
+	trace_emit(trace_skip, trace_skip_pruned, path, 0, 0, 0);
+	return 1;
+}
+
+/** @brief recursive function for finding word in file names in given dir.
+ *
+ * Directory is listed through traversal core (walk.c) and backend (posix, getdents or replay - -b option), so the same search runs on real filesystem and on recorded tree, and library scans list directories the same way. Subdirectories are collected during listing and searched after directory is closed: in readdir order as they were listed, in hot order (-o hot) sorted by priority from heat statistics - in first pass (hot_only) cold ones are deferred. In inode and extent order (-o inode, -o extent) they are searched in order they lie on disk, which turns seeks of rotational disk into mostly forward reads; next ones are announced to backend ahead (prefetch). With summaries (-P option) scan collects trigrams of all names into summary of directory, which is added to summary of its parent; pruned scan skips subdirectories whose summary can't contain pattern and adds their stored summaries instead, so summaries of directories it lists are kept up to date.
+ * @param word_to_find char* of word we want to find (pattern)
+ * @param root_path our directory
+ * @param node node of directory in heat statistics (pathstore_none in readdir order)
+ * @param skey key of directory in summaries (summary_nokey without -P)
+ * @param parent_bits summary of parent being built (NULL if there's none)
+ * @param hot_only 1 - defer cold subdirectories to second pass
+ * @return priority of directory (max score in its subtree); 0 in readdir order.
+ */
+static float search_rec(char* word_to_find, char *root_path, uint32_t node, uint64_t skey, uint64_t* parent_bits, int hot_only) {
+	subtree_done = 0;
+	subtree_summarized = 0;
+	if(!scanning())/** as long as we're in state of scanning */
+		return heat_subtree(&heat, node);
+
+	int hot = (scan_order==order_hot);
+	/** summary of subtree being built; it's stored only if all subdirectories have summary too (pruned ones - their stored summary) */
+	uint64_t* bits = (skey!=summary_nokey) ? calloc(summary_words, sizeof(uint64_t)) : NULL;
+	int summarize = (bits!=NULL);
+	int summary_complete = 1;
+	/** whether all subdirectories were searched whole (pruned one counts - it can't hold match) */
+	int subdirs_done = 1;
+	/** mtime is taken before listing - change during listing will be seen by next scan */
+	int64_t mtime = (hot || summarize) ? backend->mtime(backend, root_path) : 0;
+	dirs_visited++;
+	trace_enter(root_path);
+
+	/** list directory - its names are matched and summarized by hooks, subdirectories are collected */
+	search_dir d = {node, skey, bits};
+	walk_listing listing = {0};
+	int listed = walk_list(&walk, root_path, &d, &listing);
+	if(listed!=walk_listed){
+		trace_emit(trace_skip, skip_reason(listed==walk_no_access ? trace_skip_access : trace_skip_opendir), root_path, 0, 0, 0);
+		trace_exit(root_path, 0);
+		if(summarize)
+			summary_store(&summaries, skey, NULL, mtime, summary_unreadable);
+		free(bits);
+		subtree_done = 1;
+		subtree_summarized = summarize;
+		return 0;
+	}
+
+	/** statistics and summary are updated only from complete listing - interrupted one would look cold (and empty) */
+	int complete = scanning();
+	/** subdirectory lost by listing (no memory) isn't searched - subtree isn't done and its summary isn't valid */
+	if(listing.lost)
+		subdirs_done = summary_complete = 0;
+	float subtree = 0;
+	if(hot)
+		subtree = complete ? heat_update(&heat, node, listing.entries, listing.matches, mtime) : heat_subtree(&heat, node);
+	walk_order(&walk, root_path, &listing);
+	/** in inode and extent order next subdirectories are announced ahead, so they can be read in parallel */
+	int prefetch = (scan_order==order_inode || scan_order==order_extent);
+	char* path = malloc(walk_path_len*sizeof(char));
+	for(uint32_t i=0;i<listing.count;i++){
+		if(prefetch)
+			walk_prefetch(&walk, root_path, &listing, i);
+		walk_subdir* s = listing.subdirs+i;
+		walk_path(path, root_path, s->name);
+		float priority = s->priority;
+		if(prune_dir(path, s->key)){
+			if(summarize && !summary_load(&summaries, s->key, bits))
+				summary_complete = 0;
+		} else if(hot_only && priority<heat_epsilon){
+			defer_dir(path, s->node, s->key);/** deferred subtree stores its own summary later, this one stays incomplete */
+			subdirs_done = summary_complete = 0;
+		} else if(scanning()){
+			priority = search_rec(word_to_find, path, s->node, s->key, bits, hot_only);
+			subdirs_done &= subtree_done;
+			summary_complete &= subtree_summarized;
+		} else
+			subdirs_done = summary_complete = 0;
+		if(priority>subtree)
+			subtree = priority;
+	}
+	walk_listing_free(&listing);
+	complete = complete && scanning();
+	if(complete && hot)
+		heat_set_subtree(&heat, node, subtree);
+	if(summarize){
+		int valid = complete && summary_complete;
+		summary_store(&summaries, skey, bits, mtime, valid ? summary_valid : summary_none);
+		if(valid && parent_bits)
+			summary_merge(parent_bits, bits);
+		subtree_summarized = valid;
+		free(bits);
 	}
+	free(path);
+	trace_exit(root_path, listing.entries);
+	subtree_done = complete && subdirs_done;
+	if(subtree_done && scan_deadline)
+		export_covered(root_path);
+	return subtree;
+}
+
+/** @brief Fn runs scan from root in chosen order.
+ *
+ * Hot order has two passes: first one visits only subtrees with priority above heat_epsilon (hottest first) and defers cold subdirectories, second one searches deferred subtrees. Scan with no statistics yet (first cycle) degrades to readdir order.
+ */
+static void search_root(char* word_to_find){
+	if(scan_deadline){
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += scan_deadline;
+	}
+	scan_cut = cut_none;
+	walk_reset(&walk);
+	dirs_visited = dirs_pruned = 0;
+	/** listings read ahead by previous scan are stale */
+	if(backend->prefetch)
+		backend->prefetch(backend, NULL);
+	uint64_t sroot = summaries_ready ? summary_root : summary_nokey;
+	if(scan_order!=order_hot){
+		search_rec(word_to_find, "/", pathstore_none, sroot, NULL, 0);
+		return;
+	}
+	deferred_count = 0;
+	search_rec(word_to_find, "/", heat_ready ? pathstore_root : pathstore_none, sroot, NULL, 1);
+	size_t i;
+	for(i=0;i<deferred_count && scanning();i++){
+		search_rec(word_to_find, deferred[i].path, deferred[i].node, deferred[i].skey, NULL, 0);
+		/** deferred subtree could have become hot - let its ancestors know for next scan */
+		heat_propagate(&heat, deferred[i].node);
+	}
+	if(verbose>2 || (verbose && scan_cut))
+		syslog(LOG_INFO, "child: hot-first scan - %zu cold subtrees deferred, %zu searched\n", deferred_count, i);
+	for(i=0;i<deferred_count;i++)
+		free(deferred[i].path);
+	deferred_count = 0;
 }
 
 /** @brief function wraps search function for easy call.
  *
-* Function calls root version first, which calls normal search_rec, which calls search_rec, etc...
+* Function calls search_rec for "/", which calls search_rec, etc...
 * @param offset is offset in children_pids array - index (number) of child.
+* @return scan_satisfied if scan ended early because pattern reached its match limit; scan_complete otherwise.
 */
-void search_wrapper(int offset){
-	/** let's get address of char* word_to_find */
-	char* word_to_find = *(glargv + optind + offset);
+int search_wrapper(int offset){
+	/** pattern of last scan (with limit suffix), generation of config it came from, searched word and its limit */
+	static char word_to_find[__file_seeker_max_arg_len+1];
+	static unsigned int generation = 0;
+	static char word[__file_seeker_max_arg_len+1];
+	char new_word[__file_seeker_max_arg_len+1];
+
+	/** let's get our pattern from shared config - it could be changed by reload (SIGHUP) */
+	unsigned int new_generation = config_pattern(offset, new_word);
+	if(new_generation!=generation){
+		char new_bare[__file_seeker_max_arg_len+1];
+		strcpy(new_bare, new_word);
+		int new_limit = config_split_limit(new_bare);
+		if(verbose && *word_to_find && strcmp(word_to_find, new_word))
+			syslog(LOG_INFO, "child: pattern changed from %s to %s\n", word_to_find, new_word);
+		/** statistics belong to old pattern - change of limit alone keeps them */
+		if(strcmp(word, new_bare)){
+			if(heat_ready)
+				heat_free(&heat);
+			heat_ready = 0;
+		}
+		if(walk_ready)
+			walk_free(&walk);
+		walk_ready = 0;
+		strcpy(word_to_find, new_word);
+		strcpy(word, new_bare);
+		scan_limit = new_limit;
+		generation = new_generation;
+	}
+	/** we're past end of new pattern set - overlord is going to terminate us */
+	if(!*word_to_find)
+		return scan_complete;
+	if(prune_rescan && !summaries_ready){
+		if(summary_init(&summaries))
+			syslog(LOG_ERR, "child: no shared subtree summaries, pruning disabled\n");
+		else
+			summaries_ready = 1;
+	}
+	if(!walk_ready){
+		char* patterns[] = {word};
+		walk_hooks hooks = {search_stopped, search_name, search_match, search_satisfied, search_subdir, word};
+		if(walk_init(&walk, backend, matcher_kind, scan_order, patterns, &scan_limit, 1, &hooks)){
+			walk_free(&walk);
+			syslog(LOG_ERR, "child: can't compile pattern %s\n", word);
+			return scan_complete;
+		}
+		walk_ready = 1;
+		/** glob wildcards aren't substrings - such pattern can't be checked against trigrams */
+		if(summaries_ready)
+			summary_pattern(&summaries, word, matcher_kind!=matcher_glob);
+	}
+	/** every prune_rescan-th scan (and the first one) is full - it rebuilds summaries of whole tree */
+	static unsigned int scans = 0;
+	pruning = summaries_ready && (scans++ % prune_rescan)!=0;
+	if(scan_order==order_hot && !heat_ready){
+		if(heat_init(&heat))
+			syslog(LOG_ERR, "child: can't allocate directory statistics, hot order works as readdir\n");
+		else
+			heat_ready = 1;
+	}
 	if(verbose>2)
-		syslog(LOG_INFO, "started searching for: %s\n", (word_to_find));
-	/** and start rec ROOT search */
-	search_rec_root(word_to_find, "/");
+		syslog(LOG_INFO, "started searching for: %s\n", (word));
+	export_begin(offset, word);
+	trace_reset();
+	/** and start rec search from root */
+	search_root(word);
+	if(summaries_ready && verbose>1)
+		syslog(LOG_INFO, "child: %s scan visited %u directories, pruned %u subtrees\n", pruning ? "pruned" : "full", dirs_visited, dirs_pruned);
+	/** only scan which ended by itself gives complete index - unless it pruned subtrees, names created deep in them since last full scan are missed */
+	int provisional = (pruning && dirs_pruned) ? results_provisional : 0;
+	if(flag==flag_scan && !scan_cut){
+		if(provisional)
+			export_partial(provisional);
+		else
+			export_end();
+		if(scan_limit==limit_exists)
+			syslog(LOG_INFO, "pattern %s doesn't exist\n", word);
+		return scan_complete;
+	}
+	trace_emit(trace_skip, (scan_cut==cut_limit) ? trace_skip_limit : (scan_cut==cut_deadline) ? trace_skip_deadline : trace_skip_interrupted, "/", 0, 0, 0);
+	/** scan out of time budget still gives readers what it found, marked as partial */
+	if(flag==flag_scan && scan_cut==cut_deadline)
+		export_partial(results_partial | provisional);
+	else
+		export_abort();
+	if(flag!=flag_scan)
+		return scan_complete;
+	if(scan_cut==cut_deadline && verbose)
+		syslog(LOG_INFO, "child: time budget of %d s spent, scan of %s cut short\n", scan_deadline, word);
+	if(scan_cut!=cut_limit)
+		return scan_complete;
+	if(scan_limit==limit_exists)
+		syslog(LOG_INFO, "pattern %s exists\n", word);
+	else if(verbose)
+		syslog(LOG_INFO, "child: pattern %s reached limit of %d matches, scan ended early\n", word, scan_limit);
+	return scan_satisfied;
 }
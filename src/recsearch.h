@@ -1,5 +1,6 @@
 #ifndef FILE_SEEKER_RECSEARCH_H
 #define FILE_SEEKER_RECSEARCH_H
 
-void search_wrapper(int offset);
+int search_wrapper(int offset);
+void report_match(const char* path, const char* word_to_find, int is_dir);
 #endif
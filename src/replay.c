@@ -0,0 +1,226 @@
+/** @file replay.c
+ *  @brief Replay backend - serves recorded directory tree from memory.
+ *
+ * Tree is recorded as text listing, one "type path" line per entry - exactly what find / -xdev -printf '%y %p\n' prints (d - directory, f - regular file, anything else - other). Listing is loaded into path store with first child/next sibling links, so search with -b replay:file walks the same tree on every run at memory speed, without touching disks. Benchmarks can also build tree directly with replay_tree_add.
+ *  @author Kacper Hącia
+ */
+
+#include "fileseeker.h"
+
+/** @brief replay backend directory - next child node to return. */
+struct replay_dir {
+	uint32_t next;
+};
+
+/** @brief Fn initializes empty tree (root directory only).
+ * @return 0 on success; 1 on error.
+ */
+int replay_tree_init(replay_tree* t){
+	memset(t, 0, sizeof(*t));
+	if(pathstore_init(&t->ps))
+		return 1;
+	t->capacity = 1024;
+	t->type = malloc(t->capacity);
+	t->first_child = malloc(sizeof(uint32_t)*t->capacity);
+	t->last_child = malloc(sizeof(uint32_t)*t->capacity);
+	t->next_sibling = malloc(sizeof(uint32_t)*t->capacity);
+	if(!t->type || !t->first_child || !t->last_child || !t->next_sibling){
+		replay_tree_free(t);
+		return 1;
+	}
+	t->type[pathstore_root] = fs_type_dir;
+	t->first_child[pathstore_root] = t->last_child[pathstore_root] = t->next_sibling[pathstore_root] = pathstore_none;
+	return 0;
+}
+
+/** @brief Fn frees tree. */
+void replay_tree_free(replay_tree* t){
+	pathstore_free(&t->ps);
+	free(t->type);
+	free(t->first_child);
+	free(t->last_child);
+	free(t->next_sibling);
+	memset(t, 0, sizeof(*t));
+}
+
+/** @brief grows per-node arrays to fit node. */
+static int tree_reserve(replay_tree* t, uint32_t node){
+	if(node<t->capacity)
+		return 0;
+	uint32_t capacity = t->capacity;
+	while(capacity<=node)
+		capacity *= 2;
+	uint8_t* type = realloc(t->type, capacity);
+	if(!type)
+		return 1;
+	t->type = type;
+	uint32_t** arrays[] = {&t->first_child, &t->last_child, &t->next_sibling};
+	for(int i=0;i<3;i++){
+		uint32_t* tmp = realloc(*arrays[i], sizeof(uint32_t)*capacity);
+		if(!tmp)
+			return 1;
+		*arrays[i] = tmp;
+	}
+	t->capacity = capacity;
+	return 0;
+}
+
+/** @brief Fn adds absolute path to tree; missing ancestors are added as directories.
+ * @return 0 on success; 1 on error.
+ */
+int replay_tree_add(replay_tree* t, const char* path, int type){
+	uint32_t node = pathstore_root;
+	char name[MAX_PATH_LEN];
+	while(*path){
+		while(*path=='/')
+			path++;
+		size_t len = strcspn(path, "/");
+		if(!len)
+			break;
+		if(len>=MAX_PATH_LEN)
+			return 1;
+		memcpy(name, path, len);
+		name[len] = 0;
+		path += len;
+		uint32_t count = t->ps.count;
+		uint32_t child = pathstore_add(&t->ps, node, name);
+		if(child==pathstore_none || tree_reserve(t, child))
+			return 1;
+		if(child==count){/** new node - link it at the end of parent's children */
+			t->type[child] = fs_type_dir;
+			t->first_child[child] = t->last_child[child] = t->next_sibling[child] = pathstore_none;
+			if(t->last_child[node]==pathstore_none)
+				t->first_child[node] = child;
+			else
+				t->next_sibling[t->last_child[node]] = child;
+			t->last_child[node] = child;
+		}
+		node = child;
+	}
+	t->type[node] = type;
+	return 0;
+}
+
+/** @brief Fn loads tree from listing file ("type path" lines).
+ * @return 0 on success; 1 on error.
+ */
+int replay_tree_load(replay_tree* t, const char* file){
+	FILE* f = fopen(file, "r");
+	if(!f)
+		return 1;
+	if(replay_tree_init(t)){
+		fclose(f);
+		return 1;
+	}
+	char* line = NULL;
+	size_t cap = 0;
+	ssize_t len;
+	int err = 0;
+	while(!err && (len = getline(&line, &cap, f))>0){
+		if(line[len-1]=='\n')
+			line[--len] = 0;
+		if(len<3 || line[1]!=' ' || line[2]!='/')
+			continue;
+		int type = (line[0]=='d') ? fs_type_dir : (line[0]=='f') ? fs_type_reg : fs_type_other;
+		err = replay_tree_add(t, line+2, type);
+	}
+	free(line);
+	fclose(f);
+	if(err)
+		replay_tree_free(t);
+	return err;
+}
+
+/** @brief finds directory node of path; pathstore_none if it's missing or isn't directory. */
+static uint32_t replay_find_dir(fs_backend* b, const char* path){
+	replay_tree* t = b->data;
+	uint32_t node = pathstore_lookup(&t->ps, path);
+	if(node==pathstore_none || t->type[node]!=fs_type_dir)
+		return pathstore_none;
+	return node;
+}
+
+static int replay_access(fs_backend* b, const char* path){
+	return replay_find_dir(b, path)==pathstore_none ? -1 : 0;
+}
+
+static fs_dir* replay_open(fs_backend* b, const char* path){
+	uint32_t node = replay_find_dir(b, path);
+	if(node==pathstore_none)
+		return NULL;
+	struct replay_dir* d = malloc(sizeof(struct replay_dir));
+	if(!d)
+		return NULL;
+	d->next = ((replay_tree*) b->data)->first_child[node];
+	return (fs_dir*) d;
+}
+
+static int replay_read(fs_backend* b, fs_dir* dir, fs_entry* entry){
+	replay_tree* t = b->data;
+	struct replay_dir* d = (struct replay_dir*) dir;
+	if(d->next==pathstore_none)
+		return 0;
+	entry->name = pathstore_name(&t->ps, d->next);
+	entry->ino = d->next;
+	entry->type = t->type[d->next];
+	d->next = t->next_sibling[d->next];
+	return 1;
+}
+
+static void replay_close(fs_backend* b, fs_dir* dir){
+	free(dir);
+}
+
+/** @brief listing has no times - replayed tree never changes. */
+static int64_t replay_mtime(fs_backend* b, const char* path){
+	return 0;
+}
+
+/** @brief recorded tree has no disk - extent order falls back to inode (node) order. */
+static uint64_t replay_location(fs_backend* b, const char* path){
+	return 0;
+}
+
+static void replay_destroy(fs_backend* b){
+	replay_tree_free(b->data);
+	free(b->data);
+	free(b);
+}
+
+/** @brief Fn creates replay backend serving tree (backend takes ownership of tree).
+ * @return backend; NULL on error.
+ */
+fs_backend* backend_replay_tree(replay_tree* t){
+	fs_backend* b = calloc(1, sizeof(fs_backend));
+	if(!b)
+		return NULL;
+	b->name = "replay";
+	b->access = replay_access;
+	b->open_dir = replay_open;
+	b->read_dir = replay_read;
+	b->close_dir = replay_close;
+	b->mtime = replay_mtime;
+	b->location = replay_location;
+	b->destroy = replay_destroy;
+	b->data = t;
+	return b;
+}
+
+/** @brief Fn creates replay backend from listing file.
+ * @return backend; NULL on error.
+ */
+fs_backend* backend_replay(const char* file){
+	replay_tree* t = malloc(sizeof(replay_tree));
+	if(!t)
+		return NULL;
+	if(replay_tree_load(t, file)){
+		free(t);
+		return NULL;
+	}
+	fs_backend* b = backend_replay_tree(t);
+	if(!b){
+		replay_tree_free(t);
+		free(t);
+	}
+	return b;
+}
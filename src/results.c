@@ -0,0 +1,406 @@
+/** @file results.c
+ *  @brief Epoch-published result sets in shared memory - readers never wait for scan.
+ *
+ * Writer (child started with -r) builds result set of scan in private memory. When scan finishes, set is copied into fresh shared memory object name.epoch and published by single atomic store of new epoch into shared header - readers see either whole old set or whole new one, never half-built state. Old sets are unlinked once no reader announces their epoch; reader which already mapped set keeps it until it unmaps it (shared memory lives until last mapping is gone). Scan cut short by its time budget publishes partial set with list of subtrees it searched whole. Header and sets are removed by overlord when child is gone for good (termination, pattern removed by reload); sets retired by child which died are reclaimed by its next incarnation. Reader takes no locks: query of unchanged set is one atomic load of epoch, remapping happens only once after every publication.
+ *  @author Kacper Hącia
+ */
+
+#include "results.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/** @brief name of shared memory object with set of given epoch. */
+static void set_name(const results_header* h, uint64_t epoch, char* out, size_t len){
+	snprintf(out, len, "%s.%llu", h->name, (unsigned long long) epoch);
+}
+
+/** @brief Fn tells if some live reader announces epoch (slots of dead readers are freed). */
+static int epoch_in_use(results_header* h, uint64_t epoch){
+	int used = 0;
+	for(int i=0;i<results_slots;i++){
+		int32_t pid = __atomic_load_n(&h->slots[i].pid, __ATOMIC_SEQ_CST);
+		if(!pid || __atomic_load_n(&h->slots[i].epoch, __ATOMIC_SEQ_CST)!=epoch)
+			continue;
+		if(kill(pid, 0) && errno==ESRCH){
+			h->slots[i].epoch = 0;
+			__atomic_compare_exchange_n(&h->slots[i].pid, &pid, 0, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+			continue;
+		}
+		used = 1;
+	}
+	return used;
+}
+
+/** @brief Fn unlinks retired sets which nobody is opening. */
+static void reclaim(results_writer* w){
+	char name[96];
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int kept = 0;
+	for(int i=0;i<w->retired_count;i++){
+		if(epoch_in_use(w->header, w->retired[i])){
+			w->retired[kept++] = w->retired[i];
+			continue;
+		}
+		set_name(w->header, w->retired[i], name, sizeof(name));
+		shm_unlink(name);
+	}
+	w->retired_count = kept;
+}
+
+/** @brief Fn maps (creates if needed) header of results.
+*
+* @param w writer
+* @param name shared memory name of header (e.g. /fileseeker-results.<overlord pid>.<child index>); sets are name.epoch
+* @param index number of child, stored for readers
+* @return 0 on success; 1 on error.
+*/
+int results_writer_open(results_writer* w, const char* name, int index){
+	memset(w, 0, sizeof(*w));
+	if(strlen(name)>=sizeof(((results_header*) 0)->name))
+		return 1;
+	int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+	if(fd<0)
+		return 1;
+	if(ftruncate(fd, sizeof(results_header))){
+		close(fd);
+		return 1;
+	}
+	void* mem = mmap(NULL, sizeof(results_header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(mem==MAP_FAILED)
+		return 1;
+	w->header = mem;
+	/** header of previous incarnation of this child is continued - its readers keep working */
+	if(w->header->magic!=results_magic || w->header->version!=results_version || strcmp(w->header->name, name)){
+		memset(w->header, 0, sizeof(results_header));
+		strcpy(w->header->name, name);
+		w->header->version = results_version;
+		w->header->magic = results_magic;
+	}
+	w->header->pid = getpid();
+	w->header->index = index;
+	/** sets retired by previous incarnation were only in its memory - they're reclaimed like ours */
+	uint64_t epoch = w->header->epoch;
+	for(uint64_t e=(epoch>results_retired_max) ? epoch-results_retired_max : 1;e<epoch;e++)
+		w->retired[w->retired_count++] = e;
+	reclaim(w);
+	return 0;
+}
+
+/** @brief Fn removes header of results and all its sets (overlord - at termination and when reload retires child).
+*
+* Writer has to be gone; readers which have set mapped keep it until they unmap it.
+* @param name shared memory name of header
+*/
+void results_unlink(const char* name){
+	int fd = shm_open(name, O_RDONLY, 0);
+	if(fd<0)
+		return;
+	struct stat st;
+	results_header* h = MAP_FAILED;
+	if(!fstat(fd, &st) && (size_t) st.st_size>=sizeof(results_header))
+		h = mmap(NULL, sizeof(results_header), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(h!=MAP_FAILED){
+		if(h->magic==results_magic && h->version==results_version){
+			char set[96];
+			/** current set, retired ones and one left half-published by writer which died */
+			uint64_t epoch = h->epoch;
+			for(uint64_t e=(epoch>results_retired_max) ? epoch-results_retired_max : 1;e<=epoch+1;e++){
+				set_name(h, e, set, sizeof(set));
+				shm_unlink(set);
+			}
+		}
+		munmap(h, sizeof(results_header));
+	}
+	shm_unlink(name);
+}
+
+/** @brief Fn unmaps header and frees set being built (published sets stay). */
+void results_writer_close(results_writer* w){
+	if(w->header)
+		munmap(w->header, sizeof(results_header));
+	results_reset(w);
+	free(w->offsets);
+	free(w->records);
+	free(w->covered);
+	memset(w, 0, sizeof(*w));
+}
+
+/** @brief Fn starts building new set. */
+void results_reset(results_writer* w){
+	w->count = 0;
+	w->bytes = 0;
+	while(w->covered_count)
+		free(w->covered[--w->covered_count]);
+}
+
+/** @brief Fn records that subtree was searched whole.
+*
+* Subtrees finish in post-order, so covered subtrees inside path are at the end of list - they're replaced by path and list holds only topmost covered subtrees.
+* @return 0 on success; 1 on allocation error (subtree is just not listed as covered).
+*/
+int results_cover(results_writer* w, const char* path){
+	size_t len = strlen(path);
+	int root = !strcmp(path, "/");
+	while(w->covered_count){
+		const char* last = w->covered[w->covered_count-1];
+		if(!root && (strncmp(last, path, len) || last[len]!='/'))
+			break;
+		free(w->covered[--w->covered_count]);
+	}
+	if(w->covered_count==w->covered_capacity){
+		uint32_t capacity = w->covered_capacity ? w->covered_capacity*2 : 64;
+		char** tmp = realloc(w->covered, sizeof(char*)*capacity);
+		if(!tmp)
+			return 1;
+		w->covered = tmp;
+		w->covered_capacity = capacity;
+	}
+	if(!(w->covered[w->covered_count] = strdup(path)))
+		return 1;
+	w->covered_count++;
+	return 0;
+}
+
+/** @brief Fn adds path to set being built.
+ * @return 0 on success; 1 on allocation error.
+ */
+int results_add(results_writer* w, const char* path, int is_dir){
+	size_t len = strlen(path)+2;
+	if(w->count==w->capacity){
+		uint32_t capacity = w->capacity ? w->capacity*2 : 1024;
+		uint32_t* tmp = realloc(w->offsets, sizeof(uint32_t)*capacity);
+		if(!tmp)
+			return 1;
+		w->offsets = tmp;
+		w->capacity = capacity;
+	}
+	if(w->bytes+len>w->records_capacity){
+		size_t capacity = w->records_capacity ? w->records_capacity : 65536;
+		while(w->bytes+len>capacity)
+			capacity *= 2;
+		char* tmp = realloc(w->records, capacity);
+		if(!tmp)
+			return 1;
+		w->records = tmp;
+		w->records_capacity = capacity;
+	}
+	if(w->bytes+len>UINT32_MAX)
+		return 1;
+	w->offsets[w->count++] = w->bytes;
+	w->records[w->bytes] = is_dir ? 1 : 0;
+	memcpy(w->records+w->bytes+1, path, len-1);
+	w->bytes += len;
+	return 0;
+}
+
+/** @brief Fn publishes set being built as new current set and reclaims old ones.
+ * @param flags results_partial - set of scan cut short by time budget, published with its covered subtrees; results_provisional - set of scan which pruned subtrees; 0 - complete set
+ * @return 0 on success; 1 on error (old set stays current).
+ */
+int results_publish(results_writer* w, int flags){
+	results_header* h = w->header;
+	uint64_t epoch = h->epoch+1;
+	char name[96];
+	set_name(h, epoch, name, sizeof(name));
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if(fd<0 && errno==EEXIST){/** left by previous incarnation which died before publishing it */
+		shm_unlink(name);
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	}
+	if(fd<0)
+		return 1;
+	uint32_t covered = (flags & results_partial) ? w->covered_count : 0;
+	size_t covered_bytes = 0;
+	for(uint32_t i=0;i<covered;i++)
+		covered_bytes += strlen(w->covered[i])+1;
+	size_t base = sizeof(results_set)+sizeof(uint32_t)*((size_t) w->count+covered);
+	size_t size = base+w->bytes+covered_bytes;
+	if(size>UINT32_MAX){
+		close(fd);
+		shm_unlink(name);
+		return 1;
+	}
+	if(ftruncate(fd, size)){
+		close(fd);
+		shm_unlink(name);
+		return 1;
+	}
+	results_set* set = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(set==MAP_FAILED){
+		shm_unlink(name);
+		return 1;
+	}
+	set->magic = results_set_magic;
+	set->count = w->count;
+	set->epoch = epoch;
+	set->time = time(NULL);
+	set->bytes = w->bytes+covered_bytes;
+	set->flags = flags;
+	set->covered = covered;
+	for(uint32_t i=0;i<w->count;i++)
+		set->offsets[i] = base+w->offsets[i];
+	memcpy((char*) set+base, w->records, w->bytes);
+	size_t offset = base+w->bytes;
+	for(uint32_t i=0;i<covered;i++){
+		size_t len = strlen(w->covered[i])+1;
+		set->offsets[w->count+i] = offset;
+		memcpy((char*) set+offset, w->covered[i], len);
+		offset += len;
+	}
+	munmap(set, size);
+	/** the switch - from now on readers open new set */
+	__atomic_store_n(&h->epoch, epoch, __ATOMIC_SEQ_CST);
+	if(epoch>1){
+		/** list full - oldest one is unlinked anyway, its late reader just retries with new epoch */
+		if(w->retired_count==results_retired_max){
+			set_name(h, w->retired[0], name, sizeof(name));
+			shm_unlink(name);
+			memmove(w->retired, w->retired+1, sizeof(uint64_t)*(--w->retired_count));
+		}
+		w->retired[w->retired_count++] = epoch-1;
+	}
+	reclaim(w);
+	return 0;
+}
+
+/** @brief Fn maps header of results (file in /dev/shm or bare shared memory name) and takes reader slot.
+ * @return 0 on success; 1 on error; 2 if file is result set, not header (e.g. from /dev/shm/fileseeker-results.* glob).
+ */
+int results_reader_open(results_reader* r, const char* file){
+	memset(r, 0, sizeof(*r));
+	r->slot = -1;
+	char path[4096];
+	int fd = open(file, O_RDWR);
+	if(fd<0 && !strchr(file, '/')){/** bare shm name */
+		snprintf(path, sizeof(path), "/dev/shm/%s", file);
+		fd = open(path, O_RDWR);
+	}
+	if(fd<0)
+		return 1;
+	struct stat st;
+	if(fstat(fd, &st) || (size_t) st.st_size<sizeof(results_header)){
+		close(fd);
+		return 1;
+	}
+	results_header* h = mmap(NULL, sizeof(results_header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(h==MAP_FAILED)
+		return 1;
+	if(h->magic!=results_magic || h->version!=results_version){
+		int set = (h->magic==results_set_magic);
+		munmap(h, sizeof(results_header));
+		return set ? 2 : 1;
+	}
+	r->header = h;
+	int32_t me = getpid();
+	for(int i=0;i<results_slots;i++){
+		int32_t free_pid = 0;
+		if(__atomic_compare_exchange_n(&h->slots[i].pid, &free_pid, me, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)){
+			r->slot = i;
+			break;
+		}
+	}
+	/** without slot reader still works - it only may have to retry when set is unlinked under it */
+	return 0;
+}
+
+/** @brief Fn unmaps set and header and frees reader slot. */
+void results_reader_close(results_reader* r){
+	if(r->set)
+		munmap((void*) r->set, r->set_size);
+	if(r->header){
+		if(r->slot>=0){
+			r->header->slots[r->slot].epoch = 0;
+			__atomic_store_n(&r->header->slots[r->slot].pid, 0, __ATOMIC_SEQ_CST);
+		}
+		munmap(r->header, sizeof(results_header));
+	}
+	memset(r, 0, sizeof(*r));
+}
+
+/** @brief Fn gives current published set - mapped one if epoch didn't change, newly mapped one otherwise.
+ * @return set; NULL if nothing was published yet.
+ */
+const results_set* results_current(results_reader* r){
+	results_header* h = r->header;
+	uint64_t epoch = __atomic_load_n(&h->epoch, __ATOMIC_ACQUIRE);
+	if(epoch==r->epoch || !epoch)
+		return r->set;
+	char name[96];
+	for(int tries=0;tries<100;tries++){
+		epoch = __atomic_load_n(&h->epoch, __ATOMIC_SEQ_CST);
+		if(r->slot>=0){
+			/** announce epoch, then check it's still current - writer which didn't see announcement published newer one */
+			__atomic_store_n(&h->slots[r->slot].epoch, epoch, __ATOMIC_SEQ_CST);
+			if(__atomic_load_n(&h->epoch, __ATOMIC_SEQ_CST)!=epoch)
+				continue;
+		}
+		set_name(h, epoch, name, sizeof(name));
+		int fd = shm_open(name, O_RDONLY, 0);
+		struct stat st;
+		void* mem = MAP_FAILED;
+		if(fd>=0){
+			if(!fstat(fd, &st) && (size_t) st.st_size>=sizeof(results_set))
+				mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+			close(fd);
+		}
+		if(r->slot>=0)
+			__atomic_store_n(&h->slots[r->slot].epoch, 0, __ATOMIC_RELEASE);
+		if(mem==MAP_FAILED){
+			if(__atomic_load_n(&h->epoch, __ATOMIC_SEQ_CST)!=epoch)
+				continue;
+			return r->set;
+		}
+		if(((const results_set*) mem)->magic!=results_set_magic){
+			munmap(mem, st.st_size);
+			return r->set;
+		}
+		if(r->set)
+			munmap((void*) r->set, r->set_size);
+		r->set = mem;
+		r->set_size = st.st_size;
+		r->epoch = epoch;
+		return r->set;
+	}
+	return r->set;
+}
+
+/** @brief Fn gives i-th covered subtree of partial set (i<set->covered). */
+const char* results_covered(const results_set* set, uint32_t i){
+	return (const char*) set+set->offsets[set->count+i];
+}
+
+/** @brief Fn finds paths containing substring in current set.
+*
+* @param r reader
+* @param substring searched text; "" matches all paths
+* @param cb called for every found path (may be NULL); nonzero return stops query
+* @param arg passed to cb
+* @return count of found paths; -1 if nothing was published yet.
+*/
+long results_query(results_reader* r, const char* substring, results_callback cb, void* arg){
+	const results_set* set = results_current(r);
+	if(!set)
+		return -1;
+	long found = 0;
+	for(uint32_t i=0;i<set->count;i++){
+		const char* record = (const char*) set+set->offsets[i];
+		if(!strstr(record+1, substring))
+			continue;
+		found++;
+		if(cb && cb(record+1, record[0], arg))
+			break;
+	}
+	return found;
+}
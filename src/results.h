@@ -0,0 +1,93 @@
+#include <stdint.h>
+#include <stddef.h>
+#ifndef FILE_SEEKER_RESULTS
+#define FILE_SEEKER_RESULTS
+
+#define results_magic 0x53455246u
+#define results_set_magic 0x54455346u
+#define results_version 2
+/** count of reader slots in header - max count of readers opening result set at the same time */
+#define results_slots 64
+/** max count of published sets waiting for reclamation */
+#define results_retired_max 16
+
+/** flags of result set */
+#define results_partial 1
+#define results_provisional 2
+
+/** @brief reader announcement - epoch of set reader is opening (0 - none). */
+typedef struct results_slot {
+	volatile int32_t pid;
+	volatile uint64_t epoch;
+} results_slot;
+
+/** @brief shared header of result sets of one child (/fileseeker-results.<overlord pid>.<child index>).
+*
+* epoch is number of last published set (0 - none yet); set with epoch e is shared memory object name.e. Writer publishes set by single atomic store of epoch; readers announce epoch in their slot while they open set, so writer never unlinks set somebody is just opening.
+*/
+typedef struct results_header {
+	uint32_t magic;
+	uint32_t version;
+	int32_t pid;
+	int32_t index;
+	char name[48];
+	volatile uint64_t epoch;
+	results_slot slots[results_slots];
+} results_header;
+
+/** @brief published result set - header, offsets of records, records (is_dir byte, path, zero).
+*
+* Provisional set (results_provisional) comes from scan which skipped subtrees by summaries (-P option) - names created deep in them since last full scan are missing. Partial set (results_partial - scan ran out of its time budget) is followed by covered paths of subtrees which were searched whole (offsets count..count+covered-1, path and zero); matches outside them may be missing.
+*/
+typedef struct results_set {
+	uint32_t magic;
+	uint32_t count;
+	uint64_t epoch;
+	int64_t time;
+	uint64_t bytes;
+	uint32_t flags;
+	uint32_t covered;
+	uint32_t offsets[];
+} results_set;
+
+/** @brief writer side - header and set being built in private memory. */
+typedef struct results_writer {
+	results_header* header;
+	uint32_t* offsets;
+	uint32_t count;
+	uint32_t capacity;
+	char* records;
+	size_t bytes;
+	size_t records_capacity;
+	uint64_t retired[results_retired_max];
+	int retired_count;
+	char** covered;
+	uint32_t covered_count;
+	uint32_t covered_capacity;
+} results_writer;
+
+/** @brief reader side - header and currently mapped set. */
+typedef struct results_reader {
+	results_header* header;
+	int slot;
+	const results_set* set;
+	size_t set_size;
+	uint64_t epoch;
+} results_reader;
+
+typedef int (*results_callback)(const char* path, int is_dir, void* arg);
+
+int results_writer_open(results_writer* w, const char* name, int index);
+void results_writer_close(results_writer* w);
+void results_unlink(const char* name);
+void results_reset(results_writer* w);
+int results_add(results_writer* w, const char* path, int is_dir);
+int results_cover(results_writer* w, const char* path);
+int results_publish(results_writer* w, int flags);
+int results_reader_open(results_reader* r, const char* file);
+void results_reader_close(results_reader* r);
+const results_set* results_current(results_reader* r);
+const char* results_covered(const results_set* set, uint32_t i);
+long results_query(results_reader* r, const char* substring, results_callback cb, void* arg);
+
+#endif
@@ -0,0 +1,655 @@
+/** @file snapshot.c
+ *  @brief Index snapshot format - building, sorting, diffing, reading and writing.
+ *
+ * Snapshot is sorted list of (path, pattern, host) records with small header (kind, time, base time for deltas), string tables for hosts and patterns and, in merged snapshot, time of every host/pattern pair. On disk records are front-coded - every path stores only length of prefix shared with previous path and its own suffix - and all integers are written as LEB128 varints, so sorted listings of deep trees shrink to fraction of their text size. Delta snapshot holds only added and deleted records against snapshot with time base_time. Format is used by daemon exporting per-cycle results and by offline merge tool.
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** @brief Fn initializes empty snapshot.
+*
+* @param s snapshot to initialize
+* @param kind one of snapshot_full, snapshot_delta, snapshot_merged
+* @param time creation time (seconds since epoch)
+*/
+void snapshot_init(snapshot* s, int kind, uint64_t time){
+	memset(s, 0, sizeof(*s));
+	s->kind = kind;
+	s->time = time;
+}
+
+/** @brief Fn frees all memory owned by snapshot and leaves it empty. */
+void snapshot_free(snapshot* s){
+	for(uint32_t i=0;i<s->host_count;i++)
+		free(s->hosts[i]);
+	for(uint32_t i=0;i<s->pattern_count;i++)
+		free(s->patterns[i]);
+	for(size_t i=0;i<s->count;i++)
+		free(s->records[i].path);
+	free(s->hosts);
+	free(s->patterns);
+	free(s->pairs);
+	free(s->records);
+	snapshot_init(s, s->kind, s->time);
+}
+
+/** @brief adds string to table, if it's not there already.
+ * @return index of string in table; -1 on allocation error.
+ */
+static int table_add(char*** table, uint32_t* count, const char* str){
+	for(uint32_t i=0;i<*count;i++)
+		if(strcmp((*table)[i], str)==0)
+			return i;
+	char** tmp = realloc(*table, sizeof(char*)*(*count+1));
+	if(!tmp)
+		return -1;
+	*table = tmp;
+	if(!((*table)[*count] = strdup(str)))
+		return -1;
+	return (*count)++;
+}
+
+/** @brief Fn adds host name to host table.
+ * @return index of host; -1 on error.
+ */
+int snapshot_add_host(snapshot* s, const char* host){
+	return table_add(&s->hosts, &s->host_count, host);
+}
+
+/** @brief Fn adds pattern to pattern table.
+ * @return index of pattern; -1 on error.
+ */
+int snapshot_add_pattern(snapshot* s, const char* pattern){
+	return table_add(&s->patterns, &s->pattern_count, pattern);
+}
+
+/** @brief Fn gives time of host/pattern pair - merged snapshot has its own one for every pair it holds, other snapshots (and merged ones written by version 1) have their time for all pairs of their tables.
+ * @return 1 if snapshot holds the pair; 0 if it says nothing about it.
+ */
+int snapshot_pair_time(const snapshot* s, uint32_t host, uint32_t pattern, uint64_t* time){
+	if(host>=s->host_count || pattern>=s->pattern_count)
+		return 0;
+	if(s->kind!=snapshot_merged || !s->pair_count){
+		*time = s->time;
+		return 1;
+	}
+	for(uint32_t i=0;i<s->pair_count;i++)
+		if(s->pairs[i].host==host && s->pairs[i].pattern==pattern){
+			*time = s->pairs[i].time;
+			return 1;
+		}
+	return 0;
+}
+
+/** @brief Fn sets time of host/pattern pair of merged snapshot.
+ * @return 0 on success; 1 on error.
+ */
+int snapshot_set_pair_time(snapshot* s, uint32_t host, uint32_t pattern, uint64_t time){
+	for(uint32_t i=0;i<s->pair_count;i++)
+		if(s->pairs[i].host==host && s->pairs[i].pattern==pattern){
+			s->pairs[i].time = time;
+			return 0;
+		}
+	snap_pair* tmp = realloc(s->pairs, sizeof(snap_pair)*(s->pair_count+1));
+	if(!tmp)
+		return 1;
+	s->pairs = tmp;
+	s->pairs[s->pair_count++] = (snap_pair){host, pattern, time};
+	return 0;
+}
+
+/** @brief Fn appends record to snapshot; path is copied.
+*
+* Records are unsorted until snapshot_sort is called.
+* @return 0 on success; 1 on error.
+*/
+int snapshot_add(snapshot* s, const char* path, uint32_t host, uint32_t pattern, int op, int is_dir){
+	if(s->count==s->capacity){
+		size_t capacity = s->capacity ? s->capacity*2 : 64;
+		snap_record* tmp = realloc(s->records, capacity*sizeof(snap_record));
+		if(!tmp)
+			return 1;
+		s->records = tmp;
+		s->capacity = capacity;
+	}
+	snap_record* r = s->records + s->count;
+	if(!(r->path = strdup(path)))
+		return 1;
+	r->host = host;
+	r->pattern = pattern;
+	r->op = op;
+	r->is_dir = is_dir ? 1 : 0;
+	s->count++;
+	return 0;
+}
+
+/** @brief Fn compares two records by path, then pattern string, then host string.
+*
+* Records may come from different snapshots, so table indexes are resolved to strings.
+* @return <0, 0, >0 as strcmp.
+*/
+int snapshot_compare(const snapshot* a, const snap_record* ra, const snapshot* b, const snap_record* rb){
+	int c = strcmp(ra->path, rb->path);
+	if(c)
+		return c;
+	if(a==b && ra->pattern==rb->pattern && ra->host==rb->host)
+		return 0;
+	c = strcmp(a->patterns[ra->pattern], b->patterns[rb->pattern]);
+	if(c)
+		return c;
+	return strcmp(a->hosts[ra->host], b->hosts[rb->host]);
+}
+
+static int sort_compare(const void* x, const void* y, void* arg){
+	return snapshot_compare(arg, x, arg, y);
+}
+
+/** @brief Fn sorts records and drops duplicates. */
+void snapshot_sort(snapshot* s){
+	if(s->count<2)
+		return;
+	qsort_r(s->records, s->count, sizeof(snap_record), sort_compare, s);
+	size_t out = 0;
+	for(size_t i=1;i<s->count;i++){
+		if(snapshot_compare(s, s->records+out, s, s->records+i)==0){
+			free(s->records[out].path);
+			s->records[out] = s->records[i];
+		} else {
+			s->records[++out] = s->records[i];
+		}
+	}
+	s->count = out+1;
+}
+
+/** @brief copies string tables of src into dst (dst must be empty). */
+static int copy_tables(snapshot* dst, const snapshot* src){
+	for(uint32_t i=0;i<src->host_count;i++)
+		if(snapshot_add_host(dst, src->hosts[i])<0)
+			return 1;
+	for(uint32_t i=0;i<src->pattern_count;i++)
+		if(snapshot_add_pattern(dst, src->patterns[i])<0)
+			return 1;
+	return 0;
+}
+
+/** @brief Fn builds delta snapshot which turns prev into cur.
+*
+* Both snapshots must be sorted. delta gets tables of cur, base_time of prev and time of cur.
+* @return 0 on success; 1 on error.
+*/
+int snapshot_diff(const snapshot* prev, const snapshot* cur, snapshot* delta){
+	snapshot_init(delta, snapshot_delta, cur->time);
+	delta->base_time = prev->time;
+	if(copy_tables(delta, cur))
+		return 1;
+	/** prev tables may hold strings missing in cur (e.g. pattern was changed) */
+	size_t i = 0, j = 0;
+	while(i<prev->count || j<cur->count){
+		int c;
+		if(i==prev->count)
+			c = 1;
+		else if(j==cur->count)
+			c = -1;
+		else
+			c = snapshot_compare(prev, prev->records+i, cur, cur->records+j);
+		if(c<0){/** only in prev - deleted */
+			const snap_record* r = prev->records+i;
+			int host = snapshot_add_host(delta, prev->hosts[r->host]);
+			int pattern = snapshot_add_pattern(delta, prev->patterns[r->pattern]);
+			if(host<0 || pattern<0 || snapshot_add(delta, r->path, host, pattern, snapshot_op_del, r->is_dir))
+				return 1;
+			i++;
+		} else if(c>0){/** only in cur - added */
+			const snap_record* r = cur->records+j;
+			if(snapshot_add(delta, r->path, r->host, r->pattern, snapshot_op_add, r->is_dir))
+				return 1;
+			j++;
+		} else {
+			i++;
+			j++;
+		}
+	}
+	return 0;
+}
+
+/** @brief cursor of one input in k-way merge - next record, indexes of its table strings in out (-1 - not added yet) and in merged name tables, and time of every pair of merged name tables (-1 - input doesn't hold pair). */
+typedef struct merge_input {
+	const snapshot* s;
+	size_t pos;
+	int* out_hosts;
+	int* out_patterns;
+	uint32_t* hosts;
+	uint32_t* patterns;
+	int64_t* times;
+} merge_input;
+
+/** @brief Fn says if input a is applied after input b for pair - by time of pair, inputs of the same time in their order. */
+static int merge_later(const merge_input* in, int a, int b, int pair){
+	if(in[a].times[pair]!=in[b].times[pair])
+		return in[a].times[pair]>in[b].times[pair];
+	return a>b;
+}
+
+/** @brief heap order of inputs - next record, then input index (so equal records come in order of inputs). */
+static int merge_less(const merge_input* in, int a, int b){
+	int c = snapshot_compare(in[a].s, in[a].s->records+in[a].pos, in[b].s, in[b].s->records+in[b].pos);
+	return c ? c<0 : a<b;
+}
+
+static void heap_down(const merge_input* in, int* heap, int count, int i){
+	for(;;){
+		int min = i, l = 2*i+1, r = 2*i+2;
+		if(l<count && merge_less(in, heap[l], heap[min]))
+			min = l;
+		if(r<count && merge_less(in, heap[r], heap[min]))
+			min = r;
+		if(min==i)
+			return;
+		int tmp = heap[i];
+		heap[i] = heap[min];
+		heap[min] = tmp;
+		i = min;
+	}
+}
+
+static void heap_up(const merge_input* in, int* heap, int i){
+	while(i && merge_less(in, heap[i], heap[(i-1)/2])){
+		int tmp = heap[i];
+		heap[i] = heap[(i-1)/2];
+		heap[(i-1)/2] = tmp;
+		i = (i-1)/2;
+	}
+}
+
+/** @brief Fn maps table index of input to index in out, adding string on first use. */
+static int merge_map(int* cache, char** table, uint32_t index, snapshot* out, int (*add)(snapshot*, const char*)){
+	if(cache[index]<0)
+		cache[index] = add(out, table[index]);
+	return cache[index];
+}
+
+/** @brief Fn replays snapshots into out (which should be empty merged snapshot) in one k-way pass.
+*
+* Inputs must be sorted (snapshot_sort). They are applied separately for every host/pattern pair, in order of time of the pair (merged input has one for every pair, see snapshot_pair_time) - inputs of the same time in their order, so full snapshot must come before delta of the same time. Full (and merged) snapshot replaces everything known about its pairs, delta adds and deletes single records - so record is in out if last input which says anything about it is full one holding it or delta adding it. out gets time of every pair - time of its last input - so it can be merged again with snapshots older than some of its pairs. Every record of inputs is compared O(log count) times, out is sorted as it's built.
+* @return 0 on success; 1 on error.
+*/
+int snapshot_merge(const snapshot* const* inputs, int count, snapshot* out){
+	snapshot names;
+	snapshot_init(&names, snapshot_merged, 0);
+	merge_input* in = calloc(count ? count : 1, sizeof(merge_input));
+	int* heap = malloc(sizeof(int)*(count ? count : 1));
+	int* last_full = NULL;
+	int err = !in || !heap;
+	for(int i=0;i<count && !err;i++){
+		const snapshot* s = inputs[i];
+		in[i].s = s;
+		in[i].out_hosts = malloc(sizeof(int)*(s->host_count+1));
+		in[i].out_patterns = malloc(sizeof(int)*(s->pattern_count+1));
+		in[i].hosts = malloc(sizeof(uint32_t)*(s->host_count+1));
+		in[i].patterns = malloc(sizeof(uint32_t)*(s->pattern_count+1));
+		if(!in[i].out_hosts || !in[i].out_patterns || !in[i].hosts || !in[i].patterns){
+			err = 1;
+			break;
+		}
+		for(uint32_t h=0;h<s->host_count && !err;h++){
+			int n = snapshot_add_host(&names, s->hosts[h]);
+			in[i].out_hosts[h] = -1;
+			in[i].hosts[h] = n;
+			err = n<0;
+		}
+		for(uint32_t p=0;p<s->pattern_count && !err;p++){
+			int n = snapshot_add_pattern(&names, s->patterns[p]);
+			in[i].out_patterns[p] = -1;
+			in[i].patterns[p] = n;
+			err = n<0;
+		}
+		if(s->time>out->time)
+			out->time = s->time;
+	}
+	/** time of every pair in every input, and its last full input - older inputs don't matter for it */
+	uint32_t pairs = names.host_count*names.pattern_count;
+	if(!err && !(last_full = malloc(sizeof(int)*(pairs+1))))
+		err = 1;
+	for(uint32_t i=0;!err && i<pairs;i++)
+		last_full[i] = -1;
+	for(int i=0;i<count && !err;i++){
+		const snapshot* s = in[i].s;
+		if(!(in[i].times = malloc(sizeof(int64_t)*(pairs+1)))){
+			err = 1;
+			break;
+		}
+		for(uint32_t j=0;j<pairs;j++)
+			in[i].times[j] = -1;
+		for(uint32_t h=0;h<s->host_count;h++)
+			for(uint32_t p=0;p<s->pattern_count;p++){
+				uint64_t time;
+				int pair = in[i].hosts[h]*names.pattern_count+in[i].patterns[p];
+				if(!snapshot_pair_time(s, h, p, &time))
+					continue;
+				in[i].times[pair] = time;
+				if(s->kind!=snapshot_delta && (last_full[pair]<0 || merge_later(in, i, last_full[pair], pair)))
+					last_full[pair] = i;
+			}
+	}
+
+	int heap_count = 0;
+	for(int i=0;i<count && !err;i++)
+		if(in[i].s->count){
+			heap[heap_count] = i;
+			heap_up(in, heap, heap_count++);
+		}
+	while(heap_count && !err){
+		int first = heap[0];
+		const snap_record* key = in[first].s->records+in[first].pos;
+		const snapshot* key_s = in[first].s;
+		int pair = in[first].hosts[key->host]*names.pattern_count+in[first].patterns[key->pattern];
+		int present = 0, is_dir = 0, last = -1;
+		/** equal records of all inputs (input never holds the same record twice) - the one applied last decides */
+		for(int taken=0;heap_count;taken++){
+			int i = heap[0];
+			const snap_record* r = in[i].s->records+in[i].pos;
+			if(taken && snapshot_compare(key_s, key, in[i].s, r))
+				break;
+			if(in[i].times[pair]>=0 && (last_full[pair]<0 || !merge_later(in, last_full[pair], i, pair)) && (last<0 || merge_later(in, i, last, pair))){
+				last = i;
+				present = (in[i].s->kind!=snapshot_delta) || r->op==snapshot_op_add;
+				is_dir = r->is_dir;
+			}
+			if(++in[i].pos==in[i].s->count)
+				heap[0] = heap[--heap_count];
+			heap_down(in, heap, heap_count, 0);
+		}
+		if(!present)
+			continue;
+		int host = merge_map(in[first].out_hosts, key_s->hosts, key->host, out, snapshot_add_host);
+		int pattern = merge_map(in[first].out_patterns, key_s->patterns, key->pattern, out, snapshot_add_pattern);
+		err = host<0 || pattern<0 || snapshot_add(out, key->path, host, pattern, snapshot_op_add, is_dir);
+	}
+	/** every pair gets time of its last input, also pairs without records (e.g. pattern found nothing) */
+	for(uint32_t j=0;j<pairs && !err;j++){
+		int64_t time = -1;
+		for(int i=0;i<count;i++)
+			if(in[i].times[j]>time)
+				time = in[i].times[j];
+		if(time<0)
+			continue;
+		int host = snapshot_add_host(out, names.hosts[j/names.pattern_count]);
+		int pattern = snapshot_add_pattern(out, names.patterns[j%names.pattern_count]);
+		err = host<0 || pattern<0 || snapshot_set_pair_time(out, host, pattern, time);
+	}
+
+	for(int i=0;in && i<count;i++){
+		free(in[i].out_hosts);
+		free(in[i].out_patterns);
+		free(in[i].hosts);
+		free(in[i].patterns);
+		free(in[i].times);
+	}
+	free(in);
+	free(heap);
+	free(last_full);
+	snapshot_free(&names);
+	return err;
+}
+
+/** @brief growable output buffer for encoder. */
+typedef struct enc_buf {
+	unsigned char* data;
+	size_t len;
+	size_t capacity;
+} enc_buf;
+
+static int enc_reserve(enc_buf* b, size_t n){
+	if(b->len+n<=b->capacity)
+		return 0;
+	size_t capacity = b->capacity ? b->capacity : 4096;
+	while(capacity<b->len+n)
+		capacity *= 2;
+	unsigned char* tmp = realloc(b->data, capacity);
+	if(!tmp)
+		return 1;
+	b->data = tmp;
+	b->capacity = capacity;
+	return 0;
+}
+
+static int enc_bytes(enc_buf* b, const void* data, size_t n){
+	if(enc_reserve(b, n))
+		return 1;
+	memcpy(b->data+b->len, data, n);
+	b->len += n;
+	return 0;
+}
+
+/** @brief writes unsigned LEB128 varint. */
+static int enc_varint(enc_buf* b, uint64_t v){
+	if(enc_reserve(b, 10))
+		return 1;
+	do {
+		unsigned char byte = v & 0x7f;
+		v >>= 7;
+		b->data[b->len++] = byte | (v ? 0x80 : 0);
+	} while(v);
+	return 0;
+}
+
+/** @brief writes fixed 8 byte little endian integer. */
+static int enc_u64(enc_buf* b, uint64_t v){
+	unsigned char tmp[8];
+	for(int i=0;i<8;i++)
+		tmp[i] = (v >> (8*i)) & 0xff;
+	return enc_bytes(b, tmp, 8);
+}
+
+static int enc_string(enc_buf* b, const char* str){
+	size_t len = strlen(str);
+	return enc_varint(b, len) || enc_bytes(b, str, len);
+}
+
+/** @brief Fn writes snapshot to file.
+*
+* Records must be sorted (front coding depends on it). File is written under temporary name and renamed, so readers never see partial snapshot.
+* @return 0 on success; 1 on error.
+*/
+int snapshot_write(const snapshot* s, const char* file){
+	enc_buf b = {0};
+	unsigned char head[8];
+	memcpy(head, snapshot_magic, 6);
+	head[6] = snapshot_version;
+	head[7] = s->kind;
+	int err = enc_bytes(&b, head, 8) || enc_u64(&b, s->time) || enc_u64(&b, s->base_time);
+	err = err || enc_varint(&b, s->host_count);
+	for(uint32_t i=0;!err && i<s->host_count;i++)
+		err = enc_string(&b, s->hosts[i]);
+	err = err || enc_varint(&b, s->pattern_count);
+	for(uint32_t i=0;!err && i<s->pattern_count;i++)
+		err = enc_string(&b, s->patterns[i]);
+	err = err || enc_varint(&b, s->pair_count);
+	for(uint32_t i=0;!err && i<s->pair_count;i++)
+		err = enc_varint(&b, s->pairs[i].host) || enc_varint(&b, s->pairs[i].pattern) || enc_varint(&b, s->pairs[i].time);
+	err = err || enc_varint(&b, s->count);
+	const char* last = "";
+	for(size_t i=0;!err && i<s->count;i++){
+		const snap_record* r = s->records+i;
+		size_t shared = 0;
+		while(last[shared] && last[shared]==r->path[shared])
+			shared++;
+		size_t suffix = strlen(r->path+shared);
+		unsigned char flags = r->op | (r->is_dir << 1);
+		err = enc_bytes(&b, &flags, 1) || enc_varint(&b, shared) || enc_varint(&b, suffix)
+			|| enc_bytes(&b, r->path+shared, suffix) || enc_varint(&b, r->host) || enc_varint(&b, r->pattern);
+		last = r->path;
+	}
+
+	char* tmpname = NULL;
+	FILE* f = NULL;
+	if(err || asprintf(&tmpname, "%s.tmp", file)<0 || !(f = fopen(tmpname, "wb"))){
+		free(b.data);
+		free(tmpname);
+		return 1;
+	}
+	err = fwrite(b.data, 1, b.len, f)!=b.len;
+	err = fclose(f) || err;
+	err = err || rename(tmpname, file);
+	if(err)
+		unlink(tmpname);
+	free(b.data);
+	free(tmpname);
+	return err;
+}
+
+/** @brief input cursor for decoder. */
+typedef struct dec_buf {
+	const unsigned char* data;
+	size_t len;
+	size_t pos;
+} dec_buf;
+
+static int dec_varint(dec_buf* b, uint64_t* v){
+	*v = 0;
+	for(int shift=0;shift<64;shift+=7){
+		if(b->pos>=b->len)
+			return 1;
+		unsigned char byte = b->data[b->pos++];
+		*v |= (uint64_t)(byte & 0x7f) << shift;
+		if(!(byte & 0x80))
+			return 0;
+	}
+	return 1;
+}
+
+static int dec_u64(dec_buf* b, uint64_t* v){
+	if(b->len-b->pos<8)
+		return 1;
+	*v = 0;
+	for(int i=0;i<8;i++)
+		*v |= (uint64_t)b->data[b->pos++] << (8*i);
+	return 0;
+}
+
+/** @brief reads length-prefixed string into freshly allocated buffer. */
+static char* dec_string(dec_buf* b){
+	uint64_t len;
+	if(dec_varint(b, &len) || len>b->len-b->pos)
+		return NULL;
+	char* str = malloc(len+1);
+	if(!str)
+		return NULL;
+	memcpy(str, b->data+b->pos, len);
+	str[len] = 0;
+	b->pos += len;
+	return str;
+}
+
+/** @brief reads string table (count + strings) with given adder. */
+static int dec_table(dec_buf* b, snapshot* s, int (*add)(snapshot*, const char*)){
+	uint64_t count;
+	if(dec_varint(b, &count))
+		return 1;
+	for(uint64_t i=0;i<count;i++){
+		char* str = dec_string(b);
+		if(!str)
+			return 1;
+		int err = add(s, str)<0;
+		free(str);
+		if(err)
+			return 1;
+	}
+	return 0;
+}
+
+/** @brief reads times of host/pattern pairs (version 2 and newer). */
+static int dec_pairs(dec_buf* b, snapshot* s){
+	uint64_t count;
+	if(dec_varint(b, &count))
+		return 1;
+	for(uint64_t i=0;i<count;i++){
+		uint64_t host, pattern, time;
+		if(dec_varint(b, &host) || dec_varint(b, &pattern) || dec_varint(b, &time) || host>=s->host_count || pattern>=s->pattern_count)
+			return 1;
+		if(snapshot_set_pair_time(s, host, pattern, time))
+			return 1;
+	}
+	return 0;
+}
+
+/** @brief parses whole snapshot image; version 1 has no pair times. */
+static int snapshot_decode(snapshot* s, dec_buf* b){
+	if(b->len<8 || memcmp(b->data, snapshot_magic, 6) || !b->data[6] || b->data[6]>snapshot_version)
+		return 1;
+	snapshot_init(s, b->data[7], 0);
+	b->pos = 8;
+	if(dec_u64(b, &s->time) || dec_u64(b, &s->base_time))
+		return 1;
+	if(dec_table(b, s, snapshot_add_host) || dec_table(b, s, snapshot_add_pattern))
+		return 1;
+	if(b->data[6]>=2 && dec_pairs(b, s))
+		return 1;
+	uint64_t count;
+	if(dec_varint(b, &count))
+		return 1;
+	char* path = NULL;
+	size_t path_len = 0;
+	for(uint64_t i=0;i<count;i++){
+		uint64_t shared, suffix, host, pattern;
+		if(b->pos>=b->len)
+			break;
+		unsigned char flags = b->data[b->pos++];
+		if(dec_varint(b, &shared) || dec_varint(b, &suffix) || shared>path_len || suffix>b->len-b->pos)
+			break;
+		char* tmp = realloc(path, shared+suffix+1);
+		if(!tmp)
+			break;
+		path = tmp;
+		memcpy(path+shared, b->data+b->pos, suffix);
+		path[shared+suffix] = 0;
+		path_len = shared+suffix;
+		b->pos += suffix;
+		if(dec_varint(b, &host) || dec_varint(b, &pattern) || host>=s->host_count || pattern>=s->pattern_count)
+			break;
+		if(snapshot_add(s, path, host, pattern, flags & 1, flags & 2))
+			break;
+	}
+	free(path);
+	return s->count!=count;
+}
+
+/** @brief Fn reads snapshot from file.
+*
+* @return 0 on success; 1 on error (s is left empty).
+*/
+int snapshot_read(snapshot* s, const char* file){
+	FILE* f = fopen(file, "rb");
+	if(!f)
+		return 1;
+	dec_buf b = {0};
+	unsigned char* data = NULL;
+	size_t capacity = 0;
+	size_t n;
+	do {
+		if(b.len==capacity){
+			capacity = capacity ? capacity*2 : 65536;
+			unsigned char* tmp = realloc(data, capacity);
+			if(!tmp)
+				break;
+			data = tmp;
+		}
+		n = fread(data+b.len, 1, capacity-b.len, f);
+		b.len += n;
+	} while(n>0);
+	int err = ferror(f) || !feof(f);
+	fclose(f);
+	b.data = data;
+	snapshot_init(s, snapshot_full, 0);
+	err = err || snapshot_decode(s, &b);
+	free(data);
+	if(err)
+		snapshot_free(s);
+	return err;
+}
@@ -0,0 +1,71 @@
+#include <stdint.h>
+#include <stddef.h>
+#ifndef FILE_SEEKER_SNAPSHOT
+#define FILE_SEEKER_SNAPSHOT
+
+/** file magic; 6 bytes, followed by version and kind bytes */
+#define snapshot_magic "FSSNAP"
+#define snapshot_version 2
+
+/** snapshot kinds */
+#define snapshot_full 0
+#define snapshot_delta 1
+#define snapshot_merged 2
+
+/** record operations (delta snapshots use both, full and merged only add) */
+#define snapshot_op_add 0
+#define snapshot_op_del 1
+
+/** @brief one entry of index - path found for pattern on host.
+*
+* host and pattern are indexes into tables of owning snapshot.
+*/
+typedef struct snap_record {
+	char* path;
+	uint32_t host;
+	uint32_t pattern;
+	uint8_t op;
+	uint8_t is_dir;
+} snap_record;
+
+/** @brief time of host/pattern pair in merged snapshot - inputs of merge which hold the pair may come from different times. */
+typedef struct snap_pair {
+	uint32_t host;
+	uint32_t pattern;
+	uint64_t time;
+} snap_pair;
+
+/** @brief in-memory snapshot - header, string tables and records.
+*
+* Merged snapshot has time of every host/pattern pair it holds (pairs), full and delta snapshot have one time for all their pairs.
+*/
+typedef struct snapshot {
+	int kind;
+	uint64_t time;
+	uint64_t base_time;
+	char** hosts;
+	uint32_t host_count;
+	char** patterns;
+	uint32_t pattern_count;
+	snap_pair* pairs;
+	uint32_t pair_count;
+	snap_record* records;
+	size_t count;
+	size_t capacity;
+} snapshot;
+
+void snapshot_init(snapshot* s, int kind, uint64_t time);
+void snapshot_free(snapshot* s);
+int snapshot_add_host(snapshot* s, const char* host);
+int snapshot_add_pattern(snapshot* s, const char* pattern);
+int snapshot_pair_time(const snapshot* s, uint32_t host, uint32_t pattern, uint64_t* time);
+int snapshot_set_pair_time(snapshot* s, uint32_t host, uint32_t pattern, uint64_t time);
+int snapshot_add(snapshot* s, const char* path, uint32_t host, uint32_t pattern, int op, int is_dir);
+int snapshot_compare(const snapshot* a, const snap_record* ra, const snapshot* b, const snap_record* rb);
+void snapshot_sort(snapshot* s);
+int snapshot_diff(const snapshot* prev, const snapshot* cur, snapshot* delta);
+int snapshot_merge(const snapshot* const* inputs, int count, snapshot* out);
+int snapshot_write(const snapshot* s, const char* file);
+int snapshot_read(snapshot* s, const char* file);
+
+#endif
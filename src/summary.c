@@ -0,0 +1,264 @@
+/** @file summary.c
+ *  @brief Trigram summaries of subtrees for pruning directories which can't match.
+ *
+ * With -P n children keep for every directory bitmap of trigrams of all names beneath it (Bloom filter with summary_hashes bits per trigram). Every scan summarizes directories it lists: directory is summarized in summary_max_bits bitmap which is passed up to its parent, and before it's stored it's halved (folded) as long as few enough bits are set - small subtree gets small summary, big one near root keeps more bits instead of saturating. Subdirectory whose summary lacks some trigram of pattern (and whose mtime didn't change) can't contain match, so pruned scans skip it without listing - its stored summary goes into summary of its parent instead (summary_load), so summaries are updated incrementally along listed paths. Names can appear deeper without changing mtime of subtree root, so every n-th scan is full again.
+ *
+ * Summaries don't depend on pattern, so all children share one set: overlord maps hash table of directories (keyed by hash of path), their entries and arena of bitmaps as anonymous shared memory before forking. Entry is written under its seqlock; child which finds entry being written by another child skips it (both build the same summary), reader which sees it change treats directory as unknown and doesn't prune it. Table and arena are reserved, not allocated - only used pages take memory. Nothing is freed from them: entries of deleted or renamed directories stay, and summary which outgrows its block leaves the old one in arena. Directory which doesn't fit in them just has no summary and is never pruned - first child which runs out of table or arena logs it (once for all children).
+ *  @author Kacper Hącia
+ */
+
+#include "summary.h"
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <sys/mman.h>
+
+/** @brief every n-th scan is full (summaries rebuilt, nothing pruned); 0 - pruning disabled (-P option). */
+int prune_rescan = 0;
+
+/** @brief summaries shared with children; NULL until summary_create. */
+summary_shared* summary_memory = NULL;
+
+/** @brief Fn maps shared summaries. Must be called before forking children.
+ * @return 0 on success; 1 on error.
+ */
+int summary_create(){
+	void* mem = mmap(NULL, sizeof(summary_shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(mem==MAP_FAILED)
+		return 1;
+	summary_memory = mem;
+	return 0;
+}
+
+/** @brief Fn initializes view of shared summaries.
+ * @return 0 on success; 1 if overlord didn't map them.
+ */
+int summary_init(summary_set* s){
+	memset(s, 0, sizeof(*s));
+	s->shared = summary_memory;
+	return s->shared ? 0 : 1;
+}
+
+/** @brief Fn forgets view of summaries (shared ones stay for other children). */
+void summary_free(summary_set* s){
+	memset(s, 0, sizeof(*s));
+}
+
+/** @brief Fn gives key of subdirectory - hash of its parent key and name.
+ * @return key; summary_nokey if parent is summary_nokey.
+ */
+uint64_t summary_dir(const summary_set* s, uint64_t parent, const char* name){
+	if(parent==summary_nokey)
+		return summary_nokey;
+	uint64_t h = 14695981039346656037ull;
+	for(const char* c=name;*c;c++){
+		h ^= (unsigned char) *c;
+		h *= 1099511628211ull;
+	}
+	uint64_t key = (parent*0x9e3779b97f4a7c15ull) ^ h;
+	key ^= key >> 31;
+	key *= 0xbf58476d1ce4e5b9ull;
+	key ^= key >> 29;
+	return (key==summary_nokey || key==summary_root) ? key+2 : key;
+}
+
+/** @brief Fn logs that table or arena of summaries ran out - only first time for all children, pruning fades away for directories seen from now on. */
+static void summary_exhausted(summary_shared* m, uint32_t what){
+	if(__atomic_fetch_or(&m->exhausted, what, __ATOMIC_RELAXED) & what)
+		return;
+	if(what==summary_full_table)
+		syslog(LOG_WARNING, "child: subtree summary table is full (%u directories), new directories get no summary and aren't pruned until restart\n", summary_table_size);
+	else
+		syslog(LOG_WARNING, "child: subtree summary arena is full (%u MiB), new and grown summaries aren't stored and their directories aren't pruned until restart\n", (unsigned) (summary_arena_words*sizeof(uint64_t) >> 20));
+}
+
+/** @brief Fn finds entry of directory (adds it if create is set).
+ *
+ * Entry is filled before its number is published in slot, so child which finds slot sees key of entry. Entry of child which lost race for slot to the same directory stays unused.
+ * @return entry; NULL if it isn't there (or table is too full to add it).
+ */
+static summary_entry* summary_find(summary_shared* m, uint64_t key, int create){
+	uint32_t mask = summary_table_size-1;
+	uint32_t j = (uint32_t) (key ^ (key >> 32)) & mask;
+	uint32_t mine = 0;
+	for(int i=0;i<summary_probes;i++, j=(j+1) & mask){
+		uint32_t slot = __atomic_load_n(&m->slots[j], __ATOMIC_ACQUIRE);
+		if(!slot && create){
+			if(!mine){
+				mine = __atomic_fetch_add(&m->entry_count, 1, __ATOMIC_RELAXED)+1;
+				if(mine>summary_table_size){
+					summary_exhausted(m, summary_full_table);
+					return NULL;
+				}
+				m->entries[mine-1].key = key;
+			}
+			if(__atomic_compare_exchange_n(&m->slots[j], &slot, mine, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				return m->entries+mine-1;
+		}
+		if(!slot)
+			return NULL;
+		if(m->entries[slot-1].key==key)
+			return m->entries+slot-1;
+	}
+	/** probed region is full - table is too full to add directory */
+	if(create)
+		summary_exhausted(m, summary_full_table);
+	return NULL;
+}
+
+/** @brief positions of bits of trigram in summary_max_bits space (double hashing). */
+static inline void trigram_bits(const char* t, uint32_t* out){
+	uint32_t key = ((uint32_t) (unsigned char) t[0] << 16) | ((uint32_t) (unsigned char) t[1] << 8) | (unsigned char) t[2];
+	uint32_t h1 = key*2654435761u;
+	uint32_t h2 = (key*0x85ebca6bu) | 1;
+	for(int i=0;i<summary_hashes;i++)
+		out[i] = (h1+i*h2) >> (32-__builtin_ctz(summary_max_bits));
+}
+
+/** @brief Fn sets bits of all trigrams of name in summary being built (summary_words words). */
+void summary_add_name(uint64_t* bits, const char* name, size_t len){
+	uint32_t positions[summary_hashes];
+	for(size_t i=0;i+2<len;i++){
+		trigram_bits(name+i, positions);
+		for(int k=0;k<summary_hashes;k++)
+			bits[positions[k]/64] |= 1ull << (positions[k]%64);
+	}
+}
+
+/** @brief Fn adds summary of subdirectory just built into summary of its parent being built. */
+void summary_merge(uint64_t* bits, const uint64_t* child){
+	for(int i=0;i<summary_words;i++)
+		bits[i] |= child[i];
+}
+
+/** @brief Fn adds stored summary of directory (pruned one, not listed by this scan) into summary of its parent being built. Folded summary is repeated over summary_max_bits space - bit of trigram lands where summary_may_match looks for it in any size.
+ * @return 1 on success; 0 if directory has no valid summary (or it was rewritten while we read it).
+ */
+int summary_load(const summary_set* s, uint64_t key, uint64_t* bits){
+	if(key==summary_nokey)
+		return 0;
+	summary_entry* e = summary_find(s->shared, key, 0);
+	if(!e)
+		return 0;
+	uint32_t seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+	if((seq & 1) || e->state!=summary_valid)
+		return 0;
+	uint64_t folded[summary_words];
+	uint32_t words = (1u << e->log_bits)/64;
+	memcpy(folded, s->shared->arena+e->offset, words*sizeof(uint64_t));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if(__atomic_load_n(&e->seq, __ATOMIC_RELAXED)!=seq)
+		return 0;
+	for(uint32_t i=0;i<summary_words;i++)
+		bits[i] |= folded[i%words];
+	return 1;
+}
+
+/** @brief Fn sets pattern used by summary_may_match.
+ *
+ * @param s summaries
+ * @param pattern searched word
+ * @param usable 0 - pattern isn't plain substring (e.g. glob), never prune
+ */
+void summary_pattern(summary_set* s, const char* pattern, int usable){
+	size_t len = strlen(pattern);
+	s->pattern_ok = usable && len>=3;
+	s->pattern_count = 0;
+	for(size_t i=0;i+2<len && s->pattern_count+summary_hashes<=summary_pattern_max;i++){
+		trigram_bits(pattern+i, s->pattern+s->pattern_count);
+		s->pattern_count += summary_hashes;
+	}
+}
+
+/** @brief Fn tells if subtree of directory can contain name matching pattern.
+ * @param mtime set to mtime of directory from time its summary was built (only when 0 is returned)
+ * @return 0 only if directory has valid summary which lacks some trigram of pattern.
+ */
+int summary_may_match(const summary_set* s, uint64_t key, int64_t* mtime){
+	if(!s->pattern_ok || key==summary_nokey)
+		return 1;
+	summary_entry* e = summary_find(s->shared, key, 0);
+	if(!e)
+		return 1;
+	uint32_t seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+	if((seq & 1) || e->state!=summary_valid)
+		return 1;
+	int64_t built = e->mtime;
+	uint32_t mask = (1u << e->log_bits)-1;
+	const uint64_t* bits = s->shared->arena+e->offset;
+	int match = 1;
+	for(uint32_t i=0;i<s->pattern_count && match;i++){
+		uint32_t bit = s->pattern[i] & mask;
+		match = (bits[bit/64] >> (bit%64)) & 1;
+	}
+	/** entry rewritten while we read it - don't trust it */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if(__atomic_load_n(&e->seq, __ATOMIC_RELAXED)!=seq)
+		return 1;
+	*mtime = built;
+	return match;
+}
+
+/** @brief Fn halves summary as long as at most 1/summary_fill of its bits stays set.
+ * @param bits summary of summary_max_bits bits, folded in place
+ * @return log2 of size of folded summary.
+ */
+static int summary_fold(uint64_t* bits){
+	uint32_t words = summary_words;
+	while(words*64>summary_min_bits){
+		uint32_t half = words/2, set = 0;
+		for(uint32_t i=0;i<half;i++)
+			set += __builtin_popcountll(bits[i] | bits[i+half]);
+		if(set*summary_fill>half*64)
+			break;
+		for(uint32_t i=0;i<half;i++)
+			bits[i] |= bits[i+half];
+		words = half;
+	}
+	return __builtin_ctz(words*64);
+}
+
+/** @brief Fn saves summary of directory into shared table.
+ *
+ * @param s summaries
+ * @param key key of directory
+ * @param bits summary of summary_max_bits bits (ignored unless state is summary_valid)
+ * @param mtime modification time of directory before it was listed
+ * @param state summary_valid, summary_unreadable (directory couldn't be listed) or summary_none (listing incomplete)
+ */
+void summary_store(summary_set* s, uint64_t key, const uint64_t* bits, int64_t mtime, int state){
+	if(key==summary_nokey)
+		return;
+	summary_entry* e = summary_find(s->shared, key, 1);
+	if(!e)
+		return;
+	uint32_t seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+	/** other child is writing the same directory */
+	if((seq & 1) || !__atomic_compare_exchange_n(&e->seq, &seq, seq+1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+		return;
+	if(state==summary_valid){
+		static uint64_t folded[summary_words];
+		memcpy(folded, bits, sizeof(folded));
+		int log_bits = summary_fold(folded);
+		/** block is reused while summary fits, new one is taken from arena (old one is left there) */
+		if(!e->log_capacity || e->log_capacity<log_bits){
+			uint64_t words = (1u << log_bits)/64;
+			uint64_t top = __atomic_fetch_add(&s->shared->arena_top, words, __ATOMIC_RELAXED);
+			if(top+words<=summary_arena_words){
+				e->offset = top;
+				e->log_capacity = log_bits;
+			} else {
+				e->log_capacity = 0;
+				state = summary_none;
+				summary_exhausted(s->shared, summary_full_arena);
+			}
+		}
+		if(state==summary_valid){
+			memcpy(s->shared->arena+e->offset, folded, (1u << log_bits)/8);
+			e->log_bits = log_bits;
+		}
+	}
+	e->mtime = mtime;
+	e->state = state;
+	__atomic_store_n(&e->seq, seq+2, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,86 @@
+#include <stdint.h>
+#include <stddef.h>
+#ifndef FILE_SEEKER_SUMMARY
+#define FILE_SEEKER_SUMMARY
+
+/** size of trigram summary being built (bits; power of 2) - stored ones are folded to size fitting their subtree */
+#define summary_max_bits 32768
+#define summary_words (summary_max_bits/64)
+/** smallest stored summary (bits) */
+#define summary_min_bits 256
+/** stored summary is halved as long as at most 1/summary_fill of its bits is set (about 8 bits per trigram) */
+#define summary_fill 3
+/** bits set for every trigram */
+#define summary_hashes 3
+/** max count of bits of pattern (summary_hashes per trigram of longest pattern) */
+#define summary_pattern_max (summary_hashes*256)
+
+/** max count of directories with summary (size of shared hash table; power of 2) and size of arena of stored summaries (64-bit words) */
+#define summary_table_size (1u<<20)
+#define summary_arena_words (1u<<25)
+/** max probes of table before directory is left without summary */
+#define summary_probes 64
+
+/** what ran out in shared summaries (logged once) */
+#define summary_full_table 1
+#define summary_full_arena 2
+
+/** key of root directory; 0 - no directory */
+#define summary_root 1
+#define summary_nokey 0
+
+/** states of directory summary */
+#define summary_none 0
+#define summary_valid 1
+#define summary_unreadable 2
+
+/** @brief summary of one directory in shared table.
+*
+* key is hash of path. seq is seqlock of entry - odd while child writes it. Summary has 1<<log_bits bits at offset (words) in arena; block there has 1<<log_capacity bits and is reused while new summary fits.
+*/
+typedef struct summary_entry {
+	uint64_t key;
+	int64_t mtime;
+	volatile uint32_t seq;
+	uint32_t offset;
+	uint8_t state;
+	uint8_t log_bits;
+	uint8_t log_capacity;
+} summary_entry;
+
+/** @brief summaries shared by all children - hash table of directories (slots hold entry number+1, 0 - free), entries taken in order and arena of their bitmaps (anonymous shared memory mapped by overlord). exhausted holds summary_full_* bits of what ran out. */
+typedef struct summary_shared {
+	volatile uint64_t arena_top;
+	volatile uint32_t entry_count;
+	volatile uint32_t exhausted;
+	volatile uint32_t slots[summary_table_size];
+	summary_entry entries[summary_table_size];
+	uint64_t arena[summary_arena_words];
+} summary_shared;
+
+/** @brief trigram summaries of directory subtrees as seen by one child - shared table and bits of its pattern.
+*
+* Summary of directory has summary_hashes bits set for every trigram of every name beneath it - it's Bloom filter sized by count of trigrams of subtree. If some trigram of pattern has some of its bits clear, no name in subtree can contain pattern. pattern holds positions of pattern bits in summary_max_bits space (summary of 2^k bits uses their low k bits); pattern_ok is 0 if pattern can't be used for pruning (shorter than 3 chars, glob).
+*/
+typedef struct summary_set {
+	summary_shared* shared;
+	uint32_t pattern[summary_pattern_max];
+	uint32_t pattern_count;
+	int pattern_ok;
+} summary_set;
+
+extern int prune_rescan;
+extern summary_shared* summary_memory;
+
+int summary_create();
+int summary_init(summary_set* s);
+void summary_free(summary_set* s);
+uint64_t summary_dir(const summary_set* s, uint64_t parent, const char* name);
+void summary_pattern(summary_set* s, const char* pattern, int usable);
+void summary_add_name(uint64_t* bits, const char* name, size_t len);
+void summary_merge(uint64_t* bits, const uint64_t* child);
+int summary_load(const summary_set* s, uint64_t key, uint64_t* bits);
+int summary_may_match(const summary_set* s, uint64_t key, int64_t* mtime);
+void summary_store(summary_set* s, uint64_t key, const uint64_t* bits, int64_t mtime, int state);
+
+#endif
@@ -0,0 +1,169 @@
+/** @file trace.c
+ *  @brief Low-overhead binary tracing of scan into shared memory ring.
+ *
+ * With -T n every child maps its own ring (POSIX shared memory /fileseeker.<overlord pid>.<child index>) and writes fixed-size events into it: directory enter/exit with latency, match, skip with reason and received signal. Path which doesn't fit into event continues in extension records in next slots, so directories with the same name tail stay apart. Directory events are sampled - only every n-th directory is recorded. Writing event is few stores and one clock_gettime, so tracing can stay on in production instead of -vv syslog per comparison. Ring outlives child (respawned child continues in the same ring) and can be decoded by tools/fstrace at any time; overlord removes rings when it terminates and when reload retires child.
+ *  @author Kacper Hącia
+ */
+
+#include "fileseeker.h"
+#include <stdint.h>
+
+/** @brief sampling of directory events - record every n-th directory; 0 - tracing disabled. */
+int trace_sample = 0;
+
+/** @brief count of events in ring. */
+int trace_capacity = trace_default_capacity;
+
+/** @brief ring of this child; NULL if tracing is disabled. */
+trace_ring* trace = NULL;
+
+/** @brief frame of directory stack - needed to compute exclusive latency. */
+typedef struct trace_frame {
+	uint64_t start;
+	uint64_t children;
+	int sampled;
+} trace_frame;
+
+static trace_frame frames[trace_max_depth];
+static int depth = 0;
+static uint64_t dirs_seen = 0;
+
+static uint64_t now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+/** @brief Fn builds shm name of ring of child with given index of overlord owner. */
+void trace_name(char* name, size_t size, int owner, int index){
+	snprintf(name, size, "/fileseeker.%d.%d", owner, index);
+}
+
+/** @brief Fn removes ring of child with given index (overlord only - at termination and when reload retires child). Child which still has it mapped keeps writing into memory which is freed when it exits. */
+void trace_unlink(int index){
+	if(!trace_sample)
+		return;
+	char name[64];
+	trace_name(name, sizeof(name), (int) getpid(), index);
+	shm_unlink(name);
+}
+
+/** @brief Fn maps trace ring of child with given index (creates it if needed).
+ * @return 0 on success (or tracing disabled); 1 on error.
+ */
+int trace_open(int index){
+	if(!trace_sample)
+		return 0;
+	char name[64];
+	trace_name(name, sizeof(name), (int) ppid, index);
+	int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+	if(fd<0)
+		return 1;
+	/** slot is picked by mask, so capacity is rounded up to power of two */
+	int capacity = 1;
+	while(capacity<trace_capacity)
+		capacity <<= 1;
+	trace_capacity = capacity;
+	size_t size = sizeof(trace_ring) + sizeof(trace_event)*(size_t)trace_capacity;
+	if(ftruncate(fd, size)){
+		close(fd);
+		return 1;
+	}
+	void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(mem==MAP_FAILED)
+		return 1;
+	trace = mem;
+	/** ring of previous incarnation of this child (same size) is continued */
+	if(trace->magic!=trace_magic || trace->version!=trace_version || trace->capacity!=(uint32_t) trace_capacity){
+		memset(trace, 0, sizeof(trace_ring));
+		trace->capacity = trace_capacity;
+		trace->version = trace_version;
+		trace->index = index;
+		trace->magic = trace_magic;
+	}
+	trace->sample = trace_sample;
+	trace->pid = getpid();
+	if(verbose>2)
+		syslog(LOG_DEBUG, "child: tracing into %s (%d events, sample 1/%d)\n", name, trace_capacity, trace_sample);
+	return 0;
+}
+
+/** @brief Fn writes event into ring.
+*
+* Slots of event and extension records of its path are reserved with one atomic add, so they're contiguous and it's safe to call from signal handler interrupting another trace_emit. Extension records are written before event is published, so decoder which sees event sees its whole path.
+*/
+void trace_emit(int type, int arg, const char* path, uint64_t latency_ns, uint64_t total_ns, uint32_t entries){
+	if(!trace)
+		return;
+	size_t len = path ? strlen(path) : 0;
+	size_t ext = (len>trace_path_len-1) ? (len-(trace_path_len-1)+trace_ext_len-1)/trace_ext_len : 0;
+	/** path too long even for extensions (or for small ring) keeps its tail */
+	size_t max_ext = trace->capacity/4<trace_max_ext ? trace->capacity/4 : trace_max_ext;
+	if(ext>max_ext){
+		ext = max_ext;
+		path += len-(trace_path_len-1+ext*trace_ext_len);
+		len = trace_path_len-1+ext*trace_ext_len;
+	}
+	uint64_t n = __atomic_fetch_add(&trace->head, 1+ext, __ATOMIC_RELAXED);
+	trace_event* e = trace->events + (n & (trace->capacity-1));
+	/** type 0 tells decoder that slot is being rewritten */
+	__atomic_store_n(&e->type, 0, __ATOMIC_RELAXED);
+	for(size_t i=1;i<=ext;i++){
+		trace_ext* x = (trace_ext*) (trace->events + ((n+i) & (trace->capacity-1)));
+		size_t offset = trace_path_len-1+(i-1)*trace_ext_len;
+		size_t part = (len-offset<trace_ext_len) ? len-offset : trace_ext_len;
+		__atomic_store_n(&x->type, 0, __ATOMIC_RELAXED);
+		x->seq = i;
+		x->len = part;
+		memcpy(x->text, path+offset, part);
+		__atomic_store_n(&x->type, trace_path_ext, __ATOMIC_RELEASE);
+	}
+	e->time_ns = now_ns();
+	e->latency_ns = latency_ns;
+	e->total_ns = total_ns;
+	e->entries = entries;
+	e->arg = arg;
+	e->ext = ext;
+	e->path[0] = 0;
+	if(path){
+		strncpy(e->path, path, trace_path_len-1);
+		e->path[trace_path_len-1] = 0;
+	}
+	__atomic_store_n(&e->type, type, __ATOMIC_RELEASE);
+}
+
+/** @brief Fn marks start of directory visit (recorded if directory is sampled). */
+void trace_enter(const char* path){
+	if(!trace)
+		return;
+	if(depth<trace_max_depth){
+		trace_frame* f = frames+depth;
+		f->start = now_ns();
+		f->children = 0;
+		f->sampled = (dirs_seen++ % trace_sample)==0;
+		if(f->sampled)
+			trace_emit(trace_dir_enter, depth, path, 0, 0, 0);
+	}
+	depth++;
+}
+
+/** @brief Fn marks end of directory visit; records own and total latency. */
+void trace_exit(const char* path, uint32_t entries){
+	if(!trace || !depth)
+		return;
+	depth--;
+	if(depth>=trace_max_depth)
+		return;
+	trace_frame* f = frames+depth;
+	uint64_t total = now_ns()-f->start;
+	if(depth>0)
+		frames[depth-1].children += total;
+	if(f->sampled)
+		trace_emit(trace_dir_exit, depth, path, total-f->children, total, entries);
+}
+
+/** @brief Fn drops directory stack - called at start of every scan. */
+void trace_reset(){
+	depth = 0;
+}
@@ -0,0 +1,86 @@
+#include <stddef.h>
+#include <stdint.h>
+#ifndef FILE_SEEKER_TRACE
+#define FILE_SEEKER_TRACE
+
+#define trace_magic 0x52545346u
+#define trace_version 2
+/** default ring capacity (events); 64 bytes each */
+#define trace_default_capacity 65536
+/** max depth of directory stack used for exclusive latency */
+#define trace_max_depth 1024
+/** length of path head stored in event (with terminating zero) and of path part in every extension record */
+#define trace_path_len 31
+#define trace_ext_len 60
+/** max count of extension records of one event - longer paths keep their tail */
+#define trace_max_ext 40
+
+/** event types */
+#define trace_dir_enter 1
+#define trace_dir_exit 2
+#define trace_match 3
+#define trace_skip 4
+#define trace_signal 5
+#define trace_path_ext 6
+
+/** skip reasons (arg of trace_skip) */
+#define trace_skip_access 1
+#define trace_skip_opendir 2
+#define trace_skip_interrupted 3
+#define trace_skip_deadline 4
+#define trace_skip_limit 5
+#define trace_skip_pruned 6
+#define trace_skip_timeout 7
+#define trace_skip_degraded 8
+
+/** @brief one fixed-size (64 bytes) binary trace event.
+*
+* For trace_dir_exit latency_ns is time spent in directory itself (reading and matching its entries), total_ns also counts subdirectories. path holds head of path (first trace_path_len-1 chars); rest of longer path is in ext extension records in slots right after event.
+*/
+typedef struct trace_event {
+	uint16_t type;
+	uint16_t arg;
+	uint32_t entries;
+	uint64_t time_ns;
+	uint64_t latency_ns;
+	uint64_t total_ns;
+	uint8_t ext;
+	char path[trace_path_len];
+} trace_event;
+
+/** @brief extension record (type trace_path_ext) - next len bytes of path of event before it; seq counts from 1. */
+typedef struct trace_ext {
+	uint16_t type;
+	uint8_t seq;
+	uint8_t len;
+	char text[trace_ext_len];
+} trace_ext;
+
+/** @brief shared memory ring of one worker - header followed by capacity events.
+*
+* head counts all events ever written; event n lives in slot n % capacity, so ring keeps last capacity events.
+*/
+typedef struct trace_ring {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t capacity;
+	uint32_t sample;
+	int32_t pid;
+	int32_t index;
+	volatile uint64_t head;
+	trace_event events[];
+} trace_ring;
+
+extern int trace_sample;
+extern int trace_capacity;
+extern trace_ring* trace;
+
+int trace_open(int index);
+void trace_emit(int type, int arg, const char* path, uint64_t latency_ns, uint64_t total_ns, uint32_t entries);
+void trace_enter(const char* path);
+void trace_exit(const char* path, uint32_t entries);
+void trace_reset();
+void trace_name(char* name, size_t size, int owner, int index);
+void trace_unlink(int index);
+
+#endif
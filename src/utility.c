@@ -18,7 +18,7 @@ extern int sleep_time;
 * @param argv table of char tables (table of arguments) AKA char** argv or char* argv[].
 */
 void options_handler(int argc, char** argv){
-	const char* const short_options = "ht:v";
+	const char* const short_options = "ht:vs:F:p:T:b:m:o:d:n:P:rD:";
 	verbose=0;
 
 	/* struct for console options.
@@ -29,6 +29,20 @@ void options_handler(int argc, char** argv){
 		{"help", 0, NULL, 'h'},
 		{"time", 1, NULL, 't'},
 		{"verbose", 0, NULL, 'v'},
+		{"snapshot", 1, NULL, 's'},
+		{"snapshot-full", 1, NULL, 'F'},
+		{"patterns", 1, NULL, 'p'},
+		{"trace", 1, NULL, 'T'},
+		{"trace-size", 1, NULL, 'S'},
+		{"backend", 1, NULL, 'b'},
+		{"matcher", 1, NULL, 'm'},
+		{"order", 1, NULL, 'o'},
+		{"deadline", 1, NULL, 'd'},
+		{"limit", 1, NULL, 'n'},
+		{"prune", 1, NULL, 'P'},
+		{"results", 0, NULL, 'r'},
+		{"dir-timeout", 1, NULL, 'D'},
+		{"dir-threads", 1, NULL, 'W'},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -54,6 +68,89 @@ void options_handler(int argc, char** argv){
 					printf("Warning: time at -t option is 0 or less. Using default sleep time - %d sec.", sleep_time);
 			break;
 
+			case 's': /*-s dir or --snapshot dir : export per-cycle snapshots*/
+				snapshot_dir = optarg;
+			break;
+
+			case 'F': /*-F n or --snapshot-full n : every n-th snapshot is full*/
+				temp_time = atoi(optarg);
+				snapshot_full_every = (temp_time>0)? temp_time : snapshot_full_every;
+				if(temp_time<=0)
+					printf("Warning: value at -F option is 0 or less. Using default - %d.", snapshot_full_every);
+			break;
+
+			case 'p': /*-p file or --patterns file : patterns (and options) from file; reloaded on SIGHUP*/
+				patterns_file = optarg;
+			break;
+
+			case 'T': /*-T n or --trace n : binary trace into shared memory, every n-th directory*/
+				temp_time = atoi(optarg);
+				trace_sample = (temp_time>0)? temp_time : 0;
+				if(temp_time<=0)
+					printf("Warning: sampling at -T option is 0 or less. Tracing disabled.");
+			break;
+
+			case 'S': /*--trace-size n : count of events in trace ring*/
+				temp_time = atoi(optarg);
+				trace_capacity = (temp_time>0)? temp_time : trace_capacity;
+			break;
+
+			case 'b': /*-b name or --backend name : traversal backend*/
+				backend_spec = optarg;
+			break;
+
+			case 'm': /*-m name or --matcher name : name matching strategy*/
+				temp_time = matcher_parse(optarg);
+				matcher_kind = (temp_time>=0)? temp_time : matcher_kind;
+				if(temp_time<0)
+					printf("Warning: unknown matcher %s at -m option. Using %s.", optarg, matcher_name(matcher_kind));
+			break;
+
+			case 'o': /*-o name or --order name : traversal order*/
+				temp_time = order_parse(optarg);
+				scan_order = (temp_time>=0)? temp_time : scan_order;
+				if(temp_time<0)
+					printf("Warning: unknown order %s at -o option. Using readdir.", optarg);
+			break;
+
+			case 'd': /*-d n or --deadline n : time budget of one scan*/
+				temp_time = atoi(optarg);
+				scan_deadline = (temp_time>0)? temp_time : 0;
+				if(temp_time<=0)
+					printf("Warning: time at -d option is 0 or less. Scans have no time budget.");
+			break;
+
+			case 'n': /*-n n or --limit n : default match limit of patterns (count or exists)*/
+				match_limit = limit_parse(optarg);
+				if(match_limit==limit_none)
+					printf("Warning: invalid limit %s at -n option. Patterns have no limit.", optarg);
+			break;
+
+			case 'P': /*-P n or --prune n : prune subtrees by trigram summaries, every n-th scan full*/
+				temp_time = atoi(optarg);
+				prune_rescan = (temp_time>0)? temp_time : 0;
+				if(temp_time<=0)
+					printf("Warning: value at -P option is 0 or less. Pruning disabled.");
+			break;
+
+			case 'r': /*-r or --results : publish results of scans into shared memory*/
+				results_enabled = 1;
+			break;
+
+			case 'D': /*-D ms or --dir-timeout ms : read directories in helper threads, at most ms each*/
+				temp_time = atoi(optarg);
+				dir_timeout = (temp_time>0)? temp_time : 0;
+				if(temp_time<=0)
+					printf("Warning: time at -D option is 0 or less. Directories are read without timeout.");
+			break;
+
+			case 'W': /*--dir-threads n : count of helper threads for -D*/
+				temp_time = atoi(optarg);
+				guard_threads = (temp_time>0)? temp_time : guard_threads;
+				if(temp_time<=0)
+					printf("Warning: value at --dir-threads option is 0 or less. Using default - %d.", guard_threads);
+			break;
+
 			case '?': /*invalid opt*/
 				print_usage(stdout, 1);
 			break;
@@ -83,11 +180,36 @@ void options_handler(int argc, char** argv){
 * @param exit_code value to return from function.
 */
 int print_usage(FILE* stream, int exit_code){
-	fprintf(stream, "Usage: %s [-v] [-t n] [pattern1 pattern2 ...]\n", program_name);
+	fprintf(stream, "Usage: %s [-v] [-t n] [-p file] [-s dir [-F n]] [-r] [-T n] [-b backend] [-m matcher] [-o order] [-d n] [-n limit] [-P n] [-D ms] [pattern1 pattern2 ...]\n", program_name);
 	fprintf(stream,
 		"  -h   --help             Shows this help and exits.\n"
 		"  -t n --time n           Sets Daemon sleep time for n seconds.\n"
 		"  -v   --verbose          Enables verbose logging (-vv or -vvv for debug logging).\n"
+		"  -p f --patterns f       Reads more patterns (and -t/-v options) from file f; SIGHUP reloads it.\n"
+		"  -s d --snapshot d       Exports index snapshot of every finished scan into directory d.\n"
+		"  -F n --snapshot-full n  Every n-th snapshot is full, others are deltas (default 10).\n"
+		"  -r   --results          Publishes results of every finished scan into /dev/shm/fileseeker-results.*\n"
+		"                          (lock-free readers, e.g. tools/fsquery).\n"
+		"  -T n --trace n          Binary trace of every n-th directory into /dev/shm/fileseeker.*\n"
+		"                          (replaces -vv syslog of comparisons; decode with tools/fstrace).\n"
+		"       --trace-size n     Trace ring size in events (default 65536).\n"
+		"  -b b --backend b        Traversal backend: posix (default), getdents or replay:file\n"
+		"                          (file from find / -xdev -printf '%%y %%p\\n').\n"
+		"  -m m --matcher m        Name matching: strstr (default), ac, simd or glob (pattern as glob).\n"
+		"  -o o --order o          Traversal order: readdir (default), hot (subtrees with recent\n"
+		"                          matches and changes first, statistics kept between cycles), inode\n"
+		"                          (subdirectories in inode order - fewer reads from cold cache) or\n"
+		"                          extent (in order of their first block; measured not faster than inode).\n"
+		"  -d n --deadline n       Time budget of one scan in seconds; with -o hot hottest subtrees\n"
+		"                          are reported first.\n"
+		"  -n l --limit l          Default match limit of patterns: n (scan ends after n matches) or\n"
+		"                          exists (after first one). Pattern can have own: pattern/n, pattern/exists.\n"
+		"  -P n --prune n          Skip subtrees whose trigram summary can't contain pattern;\n"
+		"                          every scan updates summaries of directories it lists, every n-th\n"
+		"                          scan is full and rebuilds all of them.\n"
+		"  -D m --dir-timeout m    Reads directories in helper threads; directory stuck in one call for\n"
+		"                          m ms is skipped and its mount degraded for a while (30 s, doubling).\n"
+		"       --dir-threads n    Count of helper threads for -D (default 4).\n"
 		);
 	return exit_code;
 }
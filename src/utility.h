@@ -1,7 +1,11 @@
 #include <stdio.h>
+#include "backend.h"
 #ifndef FILE_SEEKER_UTILITY
 #define FILE_SEEKER_UTILITY
 
 extern const char* program_name;
+extern fs_backend* backend;
+extern const char* backend_spec;
+extern int matcher_kind;
 int print_usage(FILE* stream, int exit_code);
 #endif
@@ -0,0 +1,330 @@
+/** @file walk.c
+ *  @brief Traversal core shared by daemon and library - listing of one directory, matching with pattern limits and order of subdirectories.
+ *
+ * Child of daemon (recsearch.c) and scans of libfileseeker walk the tree differently - child recurses (summaries and heat statistics are built bottom-up, cold subtrees are deferred), library keeps stack shared by its threads - but every directory is handled the same way: it's listed through traversal backend, its files and subdirectories are matched against compiled patterns (counted against their limits, "pattern/N" and "pattern/exists"), subdirectories are collected and sorted in chosen order, and next ones are announced to backend ahead. Everything caller adds to it (syslog, export, trace, heat, summaries, batches of library) goes through hooks.
+ *  @author Kacper Hącia
+ */
+
+#include "walk.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief names of orders for -o option and order of library scan. */
+static const char* const order_names[order_kinds] = {"readdir", "hot", "inode", "extent"};
+
+/** @brief Fn names order. */
+const char* order_name(int order){
+	return (order>=0 && order<order_kinds) ? order_names[order] : "unknown";
+}
+
+/** @brief Fn maps order name to its id.
+ * @return order; -1 if name is unknown.
+ */
+int order_parse(const char* name){
+	for(int i=0;i<order_kinds;i++)
+		if(!strcmp(name, order_names[i]))
+			return i;
+	return -1;
+}
+
+/** @brief Fn parses match limit ("exists" or positive number).
+ * @return limit; limit_none if text isn't valid limit.
+ */
+int limit_parse(const char* text){
+	if(!strcmp(text, "exists"))
+		return limit_exists;
+	char* end;
+	long n = strtol(text, &end, 10);
+	if(end==text || *end || n<=0 || n>INT_MAX)
+		return limit_none;
+	return n;
+}
+
+/** @brief Fn cuts "/N" or "/exists" match limit suffix off pattern (names can't contain slash).
+ *
+ * @param pattern pattern; suffix is removed in place
+ * @param limit set to limit of pattern; limit_none if it has no (valid) suffix
+ * @return 0 on success; 1 if suffix isn't valid limit.
+ */
+int limit_split(char* pattern, int* limit){
+	*limit = limit_none;
+	char* slash = strrchr(pattern, '/');
+	if(!slash)
+		return 0;
+	*slash = 0;
+	*limit = limit_parse(slash+1);
+	return *limit==limit_none;
+}
+
+/** @brief Fn compiles patterns of traversal.
+ *
+ * @param w context (zeroed or freed by walk_free)
+ * @param b backend directories are listed with
+ * @param kind matching strategy (matcher.h)
+ * @param order order of subdirectories (order_*)
+ * @param words bare patterns (limits already cut off by limit_split)
+ * @param limits limit of every pattern
+ * @param count count of patterns
+ * @param hooks hooks of caller (copied; NULL - none)
+ * @return 0 on success; errno value on error.
+ */
+int walk_init(walk_ctx* w, fs_backend* b, int kind, int order, char* const* words, const int* limits, int count, const walk_hooks* hooks){
+	memset(w, 0, sizeof(*w));
+	w->backend = b;
+	w->order = order;
+	if(hooks)
+		w->hooks = *hooks;
+	pthread_mutex_init(&w->lock, NULL);
+	/** traversal without patterns only lists (benchmark of orders) */
+	if(!count)
+		return 0;
+	if(!(w->patterns = calloc(count, sizeof(walk_pattern))))
+		return ENOMEM;
+	w->pattern_count = count;
+	for(int i=0;i<count;i++){
+		walk_pattern* p = w->patterns+i;
+		if(!(p->word = strdup(words[i])))
+			return ENOMEM;
+		p->limit = limits[i];
+		/** the only pattern is matched by set matcher alone */
+		if(count>1 && !(p->single = matcher_create(kind, words+i, 1)))
+			return ENOMEM;
+	}
+	if(!(w->all = matcher_create(kind, words, count)))
+		return ENOMEM;
+	return 0;
+}
+
+void walk_free(walk_ctx* w){
+	for(int i=0;w->patterns && i<w->pattern_count;i++){
+		free(w->patterns[i].word);
+		matcher_free(w->patterns[i].single);
+	}
+	free(w->patterns);
+	matcher_free(w->all);
+	pthread_mutex_destroy(&w->lock);
+	memset(w, 0, sizeof(*w));
+}
+
+/** @brief Fn starts new scan - counters of patterns are zeroed. */
+void walk_reset(walk_ctx* w){
+	for(int i=0;i<w->pattern_count;i++)
+		w->patterns[i].count = w->patterns[i].done = 0;
+	w->satisfied = 0;
+}
+
+/** @brief Fn builds path of entry of directory (walk_path_len buffer); for "/" we concatenate without separator to avoid //home... notation. */
+void walk_path(char* path, const char* root_path, const char* name){
+	snprintf(path, walk_path_len, "%s%s%s", root_path, strcmp(root_path, "/") ? "/" : "", name);
+}
+
+/** @brief Fn counts match of pattern against its limit.
+ * @return 1 - match is reported; 0 - pattern is satisfied already.
+ */
+static int walk_take(walk_ctx* w, int i){
+	walk_pattern* p = w->patterns+i;
+	if(p->limit==limit_none){
+		__atomic_add_fetch(&p->count, 1, __ATOMIC_RELAXED);
+		return 1;
+	}
+	int max = (p->limit==limit_exists) ? 1 : p->limit;
+	int taken = 0;
+	pthread_mutex_lock(&w->lock);
+	if(p->count<max){
+		taken = 1;
+		/** satisfied pattern leaves active set; patterns without limit are never satisfied - scan ends early only if all have one */
+		if(++p->count==max){
+			__atomic_store_n(&p->done, 1, __ATOMIC_RELAXED);
+			if(++w->satisfied==w->pattern_count && w->hooks.satisfied)
+				w->hooks.satisfied(w->hooks.arg);
+		}
+	}
+	pthread_mutex_unlock(&w->lock);
+	return taken;
+}
+
+/** @brief Fn matches name against all patterns - set matcher filters names and finds one of patterns (for ac - the one which ends first), matchers of single patterns check the rest. Patterns which reached their limit are skipped before their matcher is run or lock is taken.
+ * @return count of reported matches.
+ */
+static uint32_t walk_match(walk_ctx* w, void* dir, const char* path, const char* name, int is_dir){
+	if(!w->all)
+		return 0;
+	size_t len = strlen(name);
+	int first = matcher_match(w->all, name, len);
+	if(first<0)
+		return 0;
+	uint32_t matches = 0;
+	for(int i=0;i<w->pattern_count;i++){
+		if(__atomic_load_n(&w->patterns[i].done, __ATOMIC_RELAXED))
+			continue;
+		if(i!=first && (!w->patterns[i].single || matcher_match(w->patterns[i].single, name, len)<0))
+			continue;
+		if(walk_take(w, i)){
+			if(w->hooks.match)
+				w->hooks.match(w->hooks.arg, dir, path, i, is_dir);
+			matches++;
+		}
+	}
+	return matches;
+}
+
+/** @brief Fn remembers subdirectory for visit after listing. */
+static void walk_collect(walk_ctx* w, void* dir, walk_listing* l, const fs_entry* entry){
+	if(l->count==l->capacity){
+		uint32_t capacity = l->capacity ? l->capacity*2 : 16;
+		walk_subdir* tmp = realloc(l->subdirs, sizeof(walk_subdir)*capacity);
+		if(!tmp){
+			l->lost++;
+			return;
+		}
+		l->subdirs = tmp;
+		l->capacity = capacity;
+	}
+	walk_subdir* s = l->subdirs+l->count;
+	if(!(s->name = strdup(entry->name))){
+		l->lost++;
+		return;
+	}
+	s->ino = entry->ino;
+	s->location = 0;
+	s->order = l->count++;
+	s->node = 0;
+	s->key = 0;
+	s->priority = 0;
+	if(w->hooks.subdir)
+		w->hooks.subdir(w->hooks.arg, dir, s);
+}
+
+/** @brief Fn lists one directory - matches its files and subdirectories and collects subdirectories (in readdir order, see walk_order).
+ *
+ * @param w context
+ * @param root_path directory
+ * @param dir state of directory passed to hooks
+ * @param l listing (subdirectories of previous one must be freed by walk_listing_free)
+ * @return walk_listed; walk_no_access or walk_no_open (errno of backend is kept) if directory can't be read.
+ */
+int walk_list(walk_ctx* w, const char* root_path, void* dir, walk_listing* l){
+	fs_backend* b = w->backend;
+	const walk_hooks* h = &w->hooks;
+	l->count = l->entries = l->matches = l->lost = 0;
+	/** check access - if we don't have permissions (or directory's mount doesn't answer - guard backend), return */
+	if(b->access(b, root_path))
+		return walk_no_access;
+	fs_dir* d = b->open_dir(b, root_path);
+	if(!d)
+		return walk_no_open;
+	char path[walk_path_len];
+	fs_entry entry;
+	while(!(h->stopped && h->stopped(h->arg)) && b->read_dir(b, d, &entry)>0){
+		l->entries++;
+		if(entry.type!=fs_type_dir && entry.type!=fs_type_reg)
+			continue;
+		int is_dir = (entry.type==fs_type_dir);
+		if(is_dir && (!strcmp(entry.name, ".") || !strcmp(entry.name, "..")))
+			continue;
+		if(h->name)
+			h->name(h->arg, dir, root_path, entry.name, is_dir);
+		walk_path(path, root_path, entry.name);
+		l->matches += walk_match(w, dir, path, entry.name, is_dir);
+		if(is_dir)
+			walk_collect(w, dir, l, &entry);
+	}
+	b->close_dir(b, d);
+	return walk_listed;
+}
+
+/** @brief hotter subdirectory first; equal ones keep readdir order. */
+static int compare_priority(const void* a, const void* b){
+	const walk_subdir* x = a;
+	const walk_subdir* y = b;
+	if(x->priority!=y->priority)
+		return (x->priority>y->priority) ? -1 : 1;
+	return (x->order>y->order) - (x->order<y->order);
+}
+
+/** @brief lower inode first - inode table is read forward. */
+static int compare_inode(const void* a, const void* b){
+	const walk_subdir* x = a;
+	const walk_subdir* y = b;
+	return (x->ino>y->ino) - (x->ino<y->ino);
+}
+
+/** @brief lower first block first; directories with unknown one (0) keep inode order ahead of them. */
+static int compare_extent(const void* a, const void* b){
+	const walk_subdir* x = a;
+	const walk_subdir* y = b;
+	if(x->location!=y->location)
+		return (x->location>y->location) - (x->location<y->location);
+	return compare_inode(a, b);
+}
+
+/** @brief Fn sorts collected subdirectories in order of traversal.
+ *
+ * Hot order sorts by priority given by subdir hook. Inode and extent order sort them in order they lie on disk; extent order sorts by inode first - first blocks are looked up (FIEMAP opens directory, so it reads its inode) in inode order, then subdirectories are sorted by first block. Backend with locate (guard) gets all lookups of directory at once and spreads them over its threads, instead of one blocking lookup per subdirectory.
+ */
+void walk_order(walk_ctx* w, const char* root_path, walk_listing* l){
+	if(w->order==order_readdir)
+		return;
+	if(w->order==order_hot){
+		qsort(l->subdirs, l->count, sizeof(walk_subdir), compare_priority);
+		return;
+	}
+	qsort(l->subdirs, l->count, sizeof(walk_subdir), compare_inode);
+	if(w->order!=order_extent)
+		return;
+	fs_backend* b = w->backend;
+	const walk_hooks* h = &w->hooks;
+	if(l->count<2)
+		return;
+	char path[walk_path_len];
+	char** paths = b->locate ? calloc(l->count, sizeof(char*)) : NULL;
+	uint64_t* locations = paths ? malloc(sizeof(uint64_t)*l->count) : NULL;
+	/** backend which can look them up all at once gets them in one batch */
+	if(locations){
+		uint32_t i;
+		for(i=0;i<l->count;i++){
+			walk_path(path, root_path, l->subdirs[i].name);
+			if(!(paths[i] = strdup(path)))
+				break;
+		}
+		if(i==l->count){
+			b->locate(b, (const char* const*) paths, locations, l->count);
+			for(i=0;i<l->count;i++)
+				l->subdirs[i].location = locations[i];
+		}
+	} else {
+		for(uint32_t i=0;i<l->count && !(h->stopped && h->stopped(h->arg));i++){
+			walk_path(path, root_path, l->subdirs[i].name);
+			l->subdirs[i].location = b->location(b, path);
+		}
+	}
+	for(uint32_t i=0;paths && i<l->count;i++)
+		free(paths[i]);
+	free(paths);
+	free(locations);
+	qsort(l->subdirs, l->count, sizeof(walk_subdir), compare_extent);
+}
+
+/** @brief Fn announces subdirectories to backend before visit of i-th one (read ahead by guard backend) - first order_prefetch+1 of them before the first visit, then the one order_prefetch ahead. */
+void walk_prefetch(walk_ctx* w, const char* root_path, const walk_listing* l, uint32_t i){
+	fs_backend* b = w->backend;
+	if(!b->prefetch)
+		return;
+	char path[walk_path_len];
+	for(uint32_t j=i ? i+order_prefetch : 0;j<l->count && j<=i+order_prefetch;j++){
+		walk_path(path, root_path, l->subdirs[j].name);
+		b->prefetch(b, path);
+	}
+}
+
+/** @brief Fn frees names of collected subdirectories and their array (counters of listing stay). */
+void walk_listing_free(walk_listing* l){
+	for(uint32_t i=0;i<l->count;i++)
+		free(l->subdirs[i].name);
+	free(l->subdirs);
+	l->subdirs = NULL;
+	l->count = l->capacity = 0;
+}
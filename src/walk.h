@@ -0,0 +1,102 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "backend.h"
+#include "matcher.h"
+#ifndef FILE_SEEKER_WALK
+#define FILE_SEEKER_WALK
+
+/** traversal orders (-o option) */
+#define order_readdir 0
+#define order_hot 1
+/** subdirectories in inode order, or in order of their first block on disk (FIEMAP) - fewer reads from cold cache (extent wasn't faster than inode in bench/ext4order.sh) */
+#define order_inode 2
+#define order_extent 3
+#define order_kinds 4
+/** how many subdirectories ahead are announced to backend (prefetch) in inode and extent order */
+#define order_prefetch 8
+
+/** match limits of pattern ("pattern/N", "pattern/exists" or -n option) */
+#define limit_none 0
+#define limit_exists -1
+
+/** max length of path built by traversal */
+#define walk_path_len 2048
+
+/** results of walk_list */
+#define walk_listed 0
+#define walk_no_access 1
+#define walk_no_open 2
+
+/** @brief subdirectory collected by walk_list - name, inode, first block (extent order) and position in listing; node, key and priority belong to caller (heat statistics, summaries). */
+typedef struct walk_subdir {
+	char* name;
+	uint64_t ino;
+	uint64_t location;
+	uint32_t order;
+	uint32_t node;
+	uint64_t key;
+	float priority;
+} walk_subdir;
+
+/** @brief result of walk_list - collected subdirectories and counters of listed directory; lost counts subdirectories which couldn't be collected (no memory). */
+typedef struct walk_listing {
+	walk_subdir* subdirs;
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t entries;
+	uint32_t matches;
+	uint32_t lost;
+} walk_listing;
+
+/** @brief what caller does around traversal; every hook may be NULL. arg is passed to all of them, dir is what caller passed to walk_list.
+*
+* stopped is checked before every entry - nonzero ends listing early. name gets every file and subdirectory of listed directory, match every match counted against limit of its pattern. satisfied is called once (under lock) when all patterns reached their limits. subdir fills node, key and priority of collected subdirectory.
+*/
+typedef struct walk_hooks {
+	int (*stopped)(void* arg);
+	void (*name)(void* arg, void* dir, const char* root_path, const char* name, int is_dir);
+	void (*match)(void* arg, void* dir, const char* path, int pattern, int is_dir);
+	void (*satisfied)(void* arg);
+	void (*subdir)(void* arg, void* dir, walk_subdir* s);
+	void* arg;
+} walk_hooks;
+
+/** @brief pattern of traversal - bare word, its limit, count of matches taken in current scan, whether it reached its limit (done - it's out of active set, its matcher isn't run any more) and matcher of just this pattern (NULL if it's the only one). */
+typedef struct walk_pattern {
+	char* word;
+	int limit;
+	int count;
+	int done;
+	matcher* single;
+} walk_pattern;
+
+/** @brief traversal shared by daemon and library - backend, order, compiled patterns with their limits and hooks of caller.
+*
+* Context can be used by many threads at once: lock guards counters of limited patterns and satisfied; done flags are set under it and read without it.
+*/
+typedef struct walk_ctx {
+	fs_backend* backend;
+	int order;
+	walk_hooks hooks;
+	walk_pattern* patterns;
+	int pattern_count;
+	int satisfied;
+	matcher* all;
+	pthread_mutex_t lock;
+} walk_ctx;
+
+const char* order_name(int order);
+int order_parse(const char* name);
+int limit_parse(const char* text);
+int limit_split(char* pattern, int* limit);
+int walk_init(walk_ctx* w, fs_backend* b, int kind, int order, char* const* words, const int* limits, int count, const walk_hooks* hooks);
+void walk_free(walk_ctx* w);
+void walk_reset(walk_ctx* w);
+void walk_path(char* path, const char* root_path, const char* name);
+int walk_list(walk_ctx* w, const char* root_path, void* dir, walk_listing* l);
+void walk_order(walk_ctx* w, const char* root_path, walk_listing* l);
+void walk_prefetch(walk_ctx* w, const char* root_path, const walk_listing* l, uint32_t i);
+void walk_listing_free(walk_listing* l);
+
+#endif
@@ -0,0 +1,254 @@
+/** @file snapshot_roundtrip.c
+ *  @brief Round trip test of snapshot format - export_end, snapshot_read and replay of delta chain.
+ *
+ * Test runs export driver like child does - cycles of export_begin, export_match and export_end over changing set of paths (deep shared prefixes, names across varint length boundaries, directories) with full snapshot every third cycle. After every cycle file just written is read back: full snapshot must hold exactly paths of cycle, delta applied to state rebuilt so far (snapshot_merge) must give them too. At the end all files replayed in one merge must give paths of last cycle, merged snapshot must survive write and read, and truncated file must be rejected. Last case merges delta of one host with older merged snapshot holding newer snapshot of another host - delta must still be applied.
+ *
+ * Usage: snapshot_roundtrip (exit code 0 - passed)
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "../src/fileseeker.h"
+#include <dirent.h>
+
+int verbose = 0;
+volatile pid_t ppid = 0;
+
+#define test_cycles 8
+#define test_paths 3000
+
+static int failures = 0;
+
+#define check(cond, ...) do { if(!(cond)){ fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); failures++; } } while(0)
+
+static uint64_t seed = 88172645463325252ULL;
+
+static uint64_t next_random(){
+	seed ^= seed<<13;
+	seed ^= seed>>7;
+	seed ^= seed<<17;
+	return seed;
+}
+
+/** @brief path number i - shared prefixes of deep tree, some names long enough for 2 and 3 byte lengths. */
+static char* make_path(int i){
+	char* path = NULL;
+	int len = (i%97==0) ? 16390 : (i%31==0) ? 130 : 0;
+	char* name = malloc(len+16);
+	if(len){
+		memset(name, 'a'+i%26, len);
+		sprintf(name+len, "%d", i);
+	} else {
+		sprintf(name, "file%d.txt", i);
+	}
+	if(asprintf(&path, "/srv/data/d%02d/s%03d/%s", i%13, i%101, name)<0)
+		abort();
+	free(name);
+	return path;
+}
+
+/** @brief Fn compares records of snapshot with expected paths (both sorted). */
+static void compare_set(const snapshot* s, const snapshot* expected, const char* what){
+	check(s->count==expected->count, "%s: %zu records, expected %zu", what, s->count, expected->count);
+	for(size_t i=0;i<s->count && i<expected->count;i++){
+		const snap_record* a = s->records+i;
+		const snap_record* b = expected->records+i;
+		if(strcmp(a->path, b->path) || a->is_dir!=b->is_dir || strcmp(s->patterns[a->pattern], "pattern")){
+			check(0, "%s: record %zu is %.60s, expected %.60s", what, i, a->path, b->path);
+			return;
+		}
+	}
+}
+
+/** @brief finds file written by export_end for cycle (host-index-time-cycle.fss). */
+static char* cycle_file(const char* dir, int cycle){
+	DIR* d = opendir(dir);
+	struct dirent* e;
+	char* found = NULL;
+	while(d && (e = readdir(d))){
+		const char* dash = strrchr(e->d_name, '-');
+		if(dash && !strcmp(strchr(dash, '.') ? strchr(dash, '.') : "", ".fss") && atoi(dash+1)==cycle)
+			if(asprintf(&found, "%s/%s", dir, e->d_name)<0)
+				found = NULL;
+	}
+	if(d)
+		closedir(d);
+	return found;
+}
+
+/** @brief Fn adds paths to snapshot (is_dir for names ending with slash - slash is dropped). */
+static void add_paths(snapshot* s, uint32_t host, int op, const char* const* paths){
+	for(;*paths;paths++){
+		size_t len = strlen(*paths);
+		char path[64];
+		snprintf(path, sizeof(path), "%.*s", (int)(len && (*paths)[len-1]=='/' ? len-1 : len), *paths);
+		check(!snapshot_add(s, path, host, 0, op, len && (*paths)[len-1]=='/'), "can't add %s", path);
+	}
+	snapshot_sort(s);
+}
+
+/** @brief Fn checks that merged snapshot holds exactly given host/path records (sorted by path). */
+static void compare_hosts(const snapshot* s, const char* const* expected, const char* what){
+	size_t n = 0;
+	for(;expected[n];n+=2)
+		if(n/2<s->count){
+			const snap_record* r = s->records+n/2;
+			check(!strcmp(s->hosts[r->host], expected[n]) && !strcmp(r->path, expected[n+1]), "%s: record %zu is %s %s, expected %s %s",
+				what, n/2, s->hosts[r->host], r->path, expected[n], expected[n+1]);
+		}
+	check(s->count==n/2, "%s: %zu records, expected %zu", what, s->count, n/2);
+}
+
+/** @brief merged snapshot holds host A at time 100 and host B at 500, delta of A at 300 must be applied on top of it - also when merged snapshot was written and read back. */
+static void test_pair_times(const char* dir){
+	snapshot full_a, full_b, delta_a, merged, again, result;
+	snapshot_init(&full_a, snapshot_full, 100);
+	snapshot_init(&full_b, snapshot_full, 500);
+	snapshot_init(&delta_a, snapshot_delta, 300);
+	delta_a.base_time = 100;
+	snapshot_add_host(&full_a, "A");
+	snapshot_add_host(&full_b, "B");
+	snapshot_add_host(&delta_a, "A");
+	snapshot_add_pattern(&full_a, "pattern");
+	snapshot_add_pattern(&full_b, "pattern");
+	snapshot_add_pattern(&delta_a, "pattern");
+	add_paths(&full_a, 0, snapshot_op_add, (const char* []){"/a/1", "/a/2", NULL});
+	add_paths(&full_b, 0, snapshot_op_add, (const char* []){"/b/1", NULL});
+	add_paths(&delta_a, 0, snapshot_op_del, (const char* []){"/a/1", NULL});
+	add_paths(&delta_a, 0, snapshot_op_add, (const char* []){"/a/3/", NULL});
+
+	const snapshot* first[] = {&full_a, &full_b};
+	snapshot_init(&merged, snapshot_merged, 0);
+	check(!snapshot_merge(first, 2, &merged), "merge of hosts failed");
+	uint64_t time = 0;
+	check(merged.time==500 && snapshot_pair_time(&merged, 0, 0, &time) && time==100, "merged snapshot has time %llu, pair A time %llu",
+		(unsigned long long) merged.time, (unsigned long long) time);
+
+	const char* const expected[] = {"A", "/a/2", "A", "/a/3", "B", "/b/1", NULL};
+	/** delta goes first - it's older than merged snapshot, but newer than its pair */
+	const snapshot* second[] = {&delta_a, &merged};
+	snapshot_init(&result, snapshot_merged, 0);
+	check(!snapshot_merge(second, 2, &result), "merge with delta failed");
+	compare_hosts(&result, expected, "delta after merged snapshot");
+	snapshot_free(&result);
+
+	char* out = NULL;
+	check(asprintf(&out, "%s/pairs.fss", dir)>0 && !snapshot_write(&merged, out) && !snapshot_read(&again, out), "merged snapshot with pair times can't be written and read");
+	if(out && again.kind==snapshot_merged){
+		const snapshot* third[] = {&again, &delta_a};
+		snapshot_init(&result, snapshot_merged, 0);
+		check(!snapshot_merge(third, 2, &result), "merge with read back snapshot failed");
+		compare_hosts(&result, expected, "delta after merged snapshot read back");
+		snapshot_free(&result);
+		snapshot_free(&again);
+	}
+	if(out)
+		unlink(out);
+	free(out);
+	snapshot_free(&full_a);
+	snapshot_free(&full_b);
+	snapshot_free(&delta_a);
+	snapshot_free(&merged);
+}
+
+int main(){
+	char dir[] = "/tmp/fileseeker-snaptest.XXXXXX";
+	if(!mkdtemp(dir)){
+		perror("mkdtemp");
+		return 2;
+	}
+	snapshot_dir = dir;
+	snapshot_full_every = 3;
+	int present[test_paths];
+	for(int i=0;i<test_paths;i++)
+		present[i] = next_random()%2;
+
+	snapshot state;
+	snapshot_init(&state, snapshot_merged, 0);
+	char* files[test_cycles];
+	snapshot expected;
+	for(int c=0;c<test_cycles;c++){
+		/** every cycle adds and deletes some paths */
+		for(int k=0;c && k<test_paths/10;k++)
+			present[next_random()%test_paths] ^= 1;
+		snapshot_init(&expected, snapshot_full, 0);
+		export_begin(0, "pattern");
+		for(int i=0;i<test_paths;i++)
+			if(present[i]){
+				char* path = make_path(i);
+				export_match(path, i%7==0);
+				snapshot_add(&expected, path, 0, 0, snapshot_op_add, i%7==0);
+				free(path);
+			}
+		export_end();
+		snapshot_sort(&expected);
+
+		files[c] = cycle_file(dir, c);
+		check(files[c], "cycle %d: no snapshot written", c);
+		snapshot s;
+		if(!files[c] || snapshot_read(&s, files[c])){
+			check(0, "cycle %d: snapshot can't be read", c);
+			snapshot_free(&expected);
+			continue;
+		}
+		check(s.kind==(c%3 ? snapshot_delta : snapshot_full), "cycle %d: kind %d", c, s.kind);
+		if(s.kind==snapshot_full)
+			compare_set(&s, &expected, "full snapshot");
+		const snapshot* chain[] = {&state, &s};
+		snapshot next;
+		snapshot_init(&next, snapshot_merged, 0);
+		snapshot_sort(&s);
+		check(!snapshot_merge(chain, 2, &next), "cycle %d: merge failed", c);
+		compare_set(&next, &expected, "state after replay");
+		snapshot_free(&state);
+		state = next;
+		snapshot_free(&s);
+		snapshot_free(&expected);
+	}
+
+	/** all files at once, in order of cycles */
+	snapshot inputs[test_cycles];
+	const snapshot* chain[test_cycles];
+	int n = 0;
+	for(int c=0;c<test_cycles;c++)
+		if(files[c] && !snapshot_read(inputs+n, files[c])){
+			snapshot_sort(inputs+n);
+			chain[n] = inputs+n;
+			n++;
+		}
+	snapshot merged;
+	snapshot_init(&merged, snapshot_merged, 0);
+	check(n==test_cycles && !snapshot_merge(chain, n, &merged), "merge of all snapshots failed");
+	compare_set(&merged, &state, "merge of all snapshots");
+
+	char* out = NULL;
+	snapshot again;
+	check(asprintf(&out, "%s/merged.fss", dir)>0 && !snapshot_write(&merged, out) && !snapshot_read(&again, out), "merged snapshot can't be written and read");
+	if(!failures){
+		check(again.kind==snapshot_merged, "merged snapshot has kind %d", again.kind);
+		compare_set(&again, &state, "merged snapshot read back");
+		snapshot_free(&again);
+		/** truncated file is rejected, not read as shorter index */
+		struct stat st;
+		if(!stat(out, &st) && !truncate(out, st.st_size-3))
+			check(snapshot_read(&again, out), "truncated snapshot was accepted");
+	}
+
+	test_pair_times(dir);
+
+	for(int i=0;i<n;i++)
+		snapshot_free(inputs+i);
+	for(int c=0;c<test_cycles;c++){
+		if(files[c])
+			unlink(files[c]);
+		free(files[c]);
+	}
+	if(out)
+		unlink(out);
+	free(out);
+	rmdir(dir);
+	snapshot_free(&merged);
+	snapshot_free(&state);
+	printf("snapshot_roundtrip: %s\n", failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+/** @file fsdupes.c
+ *  @brief Duplicate files report with libfileseeker - sets of identical files and bytes they reclaim.
+ *
+ * Tool runs fs_dupes (lib/dupes.c) on tree: files found by scan are grouped by size, then by hash of first and last edge bytes, and only then hashed whole in parallel; files of every set are compared byte by byte before it's printed. Every set is printed as line with size, count of copies and bytes reclaimed by keeping one of them, followed by its paths (the ones reclaiming most first). Patterns (like in fsscan) narrow files down, without them all regular files are candidates. Summary with candidates left after every stage goes to stderr; Ctrl-C cancels search.
+ *
+ * Usage: fsdupes [-r root] [-b backend] [-m matcher] [-o order] [-j threads] [-s min_size] [-e edge] [-B block] [-d ms] [-q] [pattern...]
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "../lib/libfileseeker.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static fs_cancel* cancel = NULL;
+
+static void on_interrupt(int sig){
+	fs_cancel_request(cancel);
+}
+
+/** @brief callback - prints set (nothing with -q, summary is enough). */
+static int print_set(const fs_dupes_set* set, void* arg){
+	if(*(int*) arg)
+		return 0;
+	printf("%llu bytes x %zu, reclaims %llu\n", (unsigned long long) set->size, set->count, (unsigned long long) set->size*(set->count-1));
+	for(size_t i=0;i<set->count;i++)
+		printf("\t%s\n", set->paths[i]);
+	return 0;
+}
+
+static void usage(const char* name){
+	fprintf(stderr, "Usage: %s [-r root] [-b backend] [-m matcher] [-o order] [-j threads] [-s min_size] [-e edge] [-B block] [-d ms] [-q] [pattern...]\n", name);
+}
+
+int main(int argc, char** argv){
+	fs_dupes_options o;
+	fs_dupes_options_init(&o);
+	int quiet = 0;
+	int opt;
+	while((opt = getopt(argc, argv, "r:b:m:o:j:s:e:B:d:qh"))!=-1){
+		switch (opt) {
+			case 'r':
+				o.scan.root = optarg;
+			break;
+			case 'b':
+				o.scan.backend = optarg;
+			break;
+			case 'm':
+				o.scan.matcher = optarg;
+			break;
+			case 'o':
+				o.scan.order = optarg;
+			break;
+			case 'j':
+				o.scan.threads = atoi(optarg)>0 ? atoi(optarg) : 1;
+			break;
+			case 's':
+				o.min_size = strtoull(optarg, NULL, 10);
+			break;
+			case 'e':
+				o.edge = atoi(optarg)>0 ? atoi(optarg) : fs_dupes_default_edge;
+			break;
+			case 'B':
+				o.block = atoi(optarg)>0 ? atoi(optarg) : fs_dupes_default_block;
+			break;
+			case 'd':
+				o.scan.deadline_ms = atoi(optarg);
+			break;
+			case 'q':
+				quiet = 1;
+			break;
+			default:
+				usage(argv[0]);
+				return 2;
+		}
+	}
+	o.scan.patterns = (const char* const*) argv+optind;
+	o.scan.pattern_count = argc-optind;
+	o.callback = print_set;
+	o.arg = &quiet;
+	if(!(o.scan.cancel = cancel = fs_cancel_create()))
+		return 1;
+	signal(SIGINT, on_interrupt);
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	fs_dupes_stats st;
+	int result = fs_dupes(&o, &st);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	if(result==fs_scan_error){
+		perror("fs_dupes");
+		fs_cancel_free(cancel);
+		return 1;
+	}
+	fprintf(stderr, "%s: %llu dirs, %llu files (%llu hard links), candidates by size %llu, by edges %llu, hashed whole %llu, %llu bytes read, %llu unreadable, %.3f s\n",
+		fs_scan_result_name(result), (unsigned long long) st.scan.dirs, (unsigned long long) st.files, (unsigned long long) st.hardlinks,
+		(unsigned long long) st.size_candidates, (unsigned long long) st.edge_candidates, (unsigned long long) st.full_hashed,
+		(unsigned long long) st.hashed_bytes, (unsigned long long) st.errors, (t1.tv_sec-t0.tv_sec)+(t1.tv_nsec-t0.tv_nsec)/1e9);
+	fprintf(stderr, "%llu sets, %llu duplicates, %llu bytes reclaimable\n", (unsigned long long) st.sets, (unsigned long long) st.duplicates, (unsigned long long) st.reclaimable);
+	fs_cancel_free(cancel);
+	return 0;
+}
@@ -0,0 +1,197 @@
+/** @file fsmerge.c
+ *  @brief Offline tool merging index snapshots from many hosts into one queryable file.
+ *
+ * Tool reads snapshots exported by daemons (-s option) and replays them in one k-way pass over inputs sorted once (snapshot_merge), separately for every host/pattern pair in order of its time: full (and merged) snapshot replaces everything known about its pairs, delta snapshot adds and deletes single records. Result is written as one merged snapshot, sorted by path, with time of every pair, so it can be merged again with snapshots newer than any of its pairs, or queried by the same tool.
+ *
+ * Usage: fsmerge -o out.fss in.fss... ; fsmerge [-H host] [-p pattern] -q substring file.fss
+ *  @author Kacper Hącia
+ */
+
+#include "../src/snapshot.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief time of last applied snapshot for host/pattern pair - used to detect gaps in delta chains. */
+typedef struct pair_time {
+	char* host;
+	char* pattern;
+	uint64_t time;
+} pair_time;
+
+static pair_time* pairs = NULL;
+static size_t pair_count = 0;
+
+/** @brief finds (or creates with time 0) entry for host/pattern pair. */
+static pair_time* pair_get(const char* host, const char* pattern){
+	for(size_t i=0;i<pair_count;i++)
+		if(!strcmp(pairs[i].host, host) && !strcmp(pairs[i].pattern, pattern))
+			return pairs+i;
+	pair_time* tmp = realloc(pairs, sizeof(pair_time)*(pair_count+1));
+	if(!tmp)
+		abort();
+	pairs = tmp;
+	pairs[pair_count].host = strdup(host);
+	pairs[pair_count].pattern = strdup(pattern);
+	pairs[pair_count].time = 0;
+	return pairs+pair_count++;
+}
+
+/** @brief Fn warns about delta whose base isn't the last snapshot seen for its host/pattern pair - some changes are missing. Pairs older than the last snapshot seen (merged input holds newer one) are replaced anyway and aren't checked. */
+static void check_chain(const snapshot* in, const char* name){
+	for(uint32_t h=0;h<in->host_count;h++)
+		for(uint32_t p=0;p<in->pattern_count;p++){
+			uint64_t time;
+			if(!snapshot_pair_time(in, h, p, &time))
+				continue;
+			pair_time* pt = pair_get(in->hosts[h], in->patterns[p]);
+			if(time<pt->time)
+				continue;
+			if(in->kind==snapshot_delta && pt->time!=in->base_time)
+				fprintf(stderr, "fsmerge: %s: delta base %llu doesn't follow last snapshot %llu of %s/%s - result may be incomplete\n",
+					name, (unsigned long long) in->base_time, (unsigned long long) pt->time, in->hosts[h], in->patterns[p]);
+			pt->time = time;
+		}
+}
+
+/** @brief input file with its snapshot and time of its oldest host/pattern pair, for ordering of chain check. */
+typedef struct input {
+	const char* name;
+	snapshot s;
+	uint64_t time;
+} input;
+
+/** @brief Fn gives time of oldest pair of snapshot (merged snapshot may hold pairs of many times). */
+static uint64_t oldest_pair(const snapshot* s){
+	uint64_t oldest = s->time;
+	for(uint32_t h=0;h<s->host_count;h++)
+		for(uint32_t p=0;p<s->pattern_count;p++){
+			uint64_t time;
+			if(snapshot_pair_time(s, h, p, &time) && time<oldest)
+				oldest = time;
+		}
+	return oldest;
+}
+
+static int input_compare(const void* x, const void* y){
+	const input* a = x;
+	const input* b = y;
+	if(a->time!=b->time)
+		return a->time<b->time ? -1 : 1;
+	/** full snapshot goes before delta built on top of it */
+	return (a->s.kind==snapshot_delta) - (b->s.kind==snapshot_delta);
+}
+
+/** @brief Fn merges input files into output file.
+ * @return exit code.
+ */
+static int merge(const char* out, char** files, int count){
+	input* inputs = calloc(count, sizeof(input));
+	if(!inputs)
+		return 1;
+	int n = 0;
+	for(int i=0;i<count;i++){
+		inputs[n].name = files[i];
+		if(snapshot_read(&inputs[n].s, files[i])){
+			fprintf(stderr, "fsmerge: %s: not a valid snapshot, skipped\n", files[i]);
+			continue;
+		}
+		inputs[n].time = oldest_pair(&inputs[n].s);
+		n++;
+	}
+	qsort(inputs, n, sizeof(input), input_compare);
+
+	/** every input is sorted once, then all of them are replayed in one k-way pass */
+	const snapshot** sorted = malloc(sizeof(snapshot*)*(n ? n : 1));
+	int err = !sorted;
+	for(int i=0;i<n && !err;i++){
+		snapshot_sort(&inputs[i].s);
+		check_chain(&inputs[i].s, inputs[i].name);
+		sorted[i] = &inputs[i].s;
+	}
+	snapshot state;
+	snapshot_init(&state, snapshot_merged, 0);
+	err = err || snapshot_merge(sorted, n, &state);
+	for(int i=0;i<n;i++)
+		snapshot_free(&inputs[i].s);
+	free(sorted);
+	free(inputs);
+	if(!err && (err = snapshot_write(&state, out)))
+		fprintf(stderr, "fsmerge: couldn't write %s\n", out);
+	if(!err)
+		fprintf(stderr, "fsmerge: %d snapshots merged into %s: %zu records, %u hosts, %u patterns\n", n, out, state.count, state.host_count, state.pattern_count);
+	snapshot_free(&state);
+	return err;
+}
+
+/** @brief Fn prints records of file matching filters.
+ * @return exit code; 0 if anything was found.
+ */
+static int query(const char* file, const char* substring, const char* host, const char* pattern){
+	snapshot s;
+	if(snapshot_read(&s, file)){
+		fprintf(stderr, "fsmerge: %s: not a valid snapshot\n", file);
+		return 2;
+	}
+	size_t found = 0;
+	for(size_t i=0;i<s.count;i++){
+		const snap_record* r = s.records+i;
+		if(host && strcmp(s.hosts[r->host], host))
+			continue;
+		if(pattern && strcmp(s.patterns[r->pattern], pattern))
+			continue;
+		if(!strstr(r->path, substring))
+			continue;
+		printf("%s%s\t%s\t%s%s\n", s.kind==snapshot_delta ? (r->op==snapshot_op_add ? "+" : "-") : "",
+			s.hosts[r->host], s.patterns[r->pattern], r->path, r->is_dir ? "/" : "");
+		found++;
+	}
+	snapshot_free(&s);
+	return found ? 0 : 1;
+}
+
+static void usage(FILE* stream){
+	fprintf(stream, "Usage: fsmerge -o out.fss snapshot.fss...\n"
+		"       fsmerge [-H host] [-p pattern] -q substring snapshot.fss\n"
+		"  -o f  Merges snapshots (full, delta, merged) into merged snapshot f.\n"
+		"  -q s  Prints records whose path contains s (\"\" prints all).\n"
+		"  -H h  Limits query to host h.\n"
+		"  -p p  Limits query to pattern p.\n");
+}
+
+int main(int argc, char** argv){
+	const char* out = NULL;
+	const char* substring = NULL;
+	const char* host = NULL;
+	const char* pattern = NULL;
+	int opt;
+	while((opt = getopt(argc, argv, "o:q:H:p:h"))!=-1){
+		switch (opt) {
+			case 'o':
+				out = optarg;
+			break;
+			case 'q':
+				substring = optarg;
+			break;
+			case 'H':
+				host = optarg;
+			break;
+			case 'p':
+				pattern = optarg;
+			break;
+			case 'h':
+				usage(stdout);
+				return 0;
+			default:
+				usage(stderr);
+				return 2;
+		}
+	}
+	if(out && optind<argc)
+		return merge(out, argv+optind, argc-optind);
+	if(substring && optind==argc-1)
+		return query(argv[optind], substring, host, pattern);
+	usage(stderr);
+	return 2;
+}
@@ -0,0 +1,111 @@
+/** @file fsquery.c
+ *  @brief Query of results published by children started with -r.
+ *
+ * Tool maps result headers (/dev/shm/fileseeker-results.<overlord pid>.<child index>) and prints paths containing given substring from current result set of every child. It takes no locks and never waits for scan in progress - it reads last finished scan. Set of scan which ran out of its time budget is partial; -i lists subtrees it searched whole. With -w n it repeats query every n milliseconds and prints latency of every query, which shows that readers aren't slowed down by scans and publications.
+ *
+ * Usage: fsquery [-c] [-i] [-w ms [-n count]] substring results...
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "../src/results.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static int print_path(const char* path, int is_dir, void* arg){
+	printf("%s %s\n", is_dir ? "d" : "f", path);
+	return 0;
+}
+
+static uint64_t now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+int main(int argc, char** argv){
+	int count_only = 0, info = 0, watch = 0, repeat = 0;
+	int opt;
+	while((opt = getopt(argc, argv, "ciw:n:h"))!=-1){
+		switch (opt) {
+			case 'c':
+				count_only = 1;
+			break;
+			case 'i':
+				info = 1;
+			break;
+			case 'w':
+				watch = atoi(optarg);
+			break;
+			case 'n':
+				repeat = atoi(optarg);
+			break;
+			default:
+				fprintf(opt=='h' ? stdout : stderr, "Usage: %s [-c] [-i] [-w ms [-n count]] substring results...\n"
+					"  -c     Prints only count of found paths.\n"
+					"  -i     Prints epoch, time and size of current set of every child\n"
+					"         (and subtrees searched whole by partial one).\n"
+					"  -w ms  Repeats query every ms milliseconds and prints its latency.\n"
+					"  -n n   Stops after n repetitions.\n", argv[0]);
+				return opt=='h' ? 0 : 2;
+		}
+	}
+	if(argc-optind<2){
+		fprintf(stderr, "fsquery: no substring or results given (e.g. passwd /dev/shm/fileseeker-results.*)\n");
+		return 2;
+	}
+	const char* substring = argv[optind++];
+	int reader_count = 0;
+	results_reader* readers = calloc(argc-optind, sizeof(results_reader));
+	if(!readers)
+		return 1;
+	for(int i=optind;i<argc;i++){
+		int err = results_reader_open(readers+reader_count, argv[i]);
+		if(err==1)
+			fprintf(stderr, "fsquery: %s: not a results header\n", argv[i]);
+		if(!err)
+			reader_count++;
+	}
+	if(!reader_count)
+		return 1;
+	for(int round=0;;round++){
+		long total = 0;
+		uint64_t start = now_ns();
+		for(int i=0;i<reader_count;i++){
+			long found = results_query(readers+i, substring, (count_only || watch) ? NULL : print_path, NULL);
+			if(found>0)
+				total += found;
+			const results_set* set = readers[i].set;
+			if(!round && !info && set && (set->flags & results_partial))
+				fprintf(stderr, "fsquery: child %d: last scan ran out of time budget, its results cover %u subtrees (-i lists them)\n", readers[i].header->index, set->covered);
+			else if(!round && !info && set && (set->flags & results_provisional))
+				fprintf(stderr, "fsquery: child %d: last scan pruned subtrees, names created deep in them since last full scan may be missing\n", readers[i].header->index);
+			if(info && !watch && set){
+				printf("child %d: epoch %llu, time %lld, %u paths%s\n", readers[i].header->index, (unsigned long long) set->epoch, (long long) set->time, set->count,
+					(set->flags & results_partial) ? ", partial (time budget spent), searched whole:" : (set->flags & results_provisional) ? ", provisional (subtrees pruned)" : "");
+				for(uint32_t c=0;c<set->covered;c++)
+					printf("\t%s\n", results_covered(set, c));
+			} else if(info && !watch)
+				printf("child %d: nothing published yet\n", readers[i].header->index);
+		}
+		uint64_t latency = now_ns()-start;
+		if(!watch){
+			if(count_only)
+				printf("%ld\n", total);
+			break;
+		}
+		printf("%ld paths in %.1f us\n", total, latency/1e3);
+		fflush(stdout);
+		if(repeat && round+1>=repeat)
+			break;
+		usleep(watch*1000);
+	}
+	for(int i=0;i<reader_count;i++)
+		results_reader_close(readers+i);
+	free(readers);
+	return 0;
+}
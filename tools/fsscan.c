@@ -0,0 +1,100 @@
+/** @file fsscan.c
+ *  @brief One-shot scan with libfileseeker - example of embedding scanning engine.
+ *
+ * Tool runs one scan of tree with library (lib/libfileseeker.h) and prints matches as they come in batches: type, index of pattern and path. Patterns take limits like daemon's (pattern/N, pattern/exists). Ctrl-C cancels scan through cancellation token, so matches found so far are still printed; summary with counters and result goes to stderr.
+ *
+ * Usage: fsscan [-r root] [-b backend] [-m matcher] [-o order] [-j threads] [-B batch] [-d ms] [-c] pattern...
+ *  @author Kacper Hącia
+ */
+
+#define _GNU_SOURCE
+#include "../lib/libfileseeker.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static fs_cancel* cancel = NULL;
+
+static void on_interrupt(int sig){
+	fs_cancel_request(cancel);
+}
+
+/** @brief callback - prints batch (or only counts it with -c). */
+static int print_batch(const fs_scan_match* matches, size_t count, void* arg){
+	size_t* batches = arg;
+	batches[0]++;
+	batches[1] += count;
+	if(batches[2])
+		return 0;
+	for(size_t i=0;i<count;i++)
+		printf("%s %d %s\n", matches[i].is_dir ? "d" : "f", matches[i].pattern, matches[i].path);
+	return 0;
+}
+
+int main(int argc, char** argv){
+	fs_scan_options o;
+	fs_scan_options_init(&o);
+	size_t batches[3] = {0, 0, 0};
+	int opt;
+	while((opt = getopt(argc, argv, "r:b:m:o:j:B:d:ch"))!=-1){
+		switch (opt) {
+			case 'r':
+				o.root = optarg;
+			break;
+			case 'b':
+				o.backend = optarg;
+			break;
+			case 'm':
+				o.matcher = optarg;
+			break;
+			case 'o':
+				o.order = optarg;
+			break;
+			case 'j':
+				o.threads = atoi(optarg);
+			break;
+			case 'B':
+				o.batch = atoi(optarg)>0 ? atoi(optarg) : fs_scan_default_batch;
+			break;
+			case 'd':
+				o.deadline_ms = atoi(optarg);
+			break;
+			case 'c':
+				batches[2] = 1;
+			break;
+			default:
+				fprintf(stderr, "Usage: %s [-r root] [-b backend] [-m matcher] [-o order] [-j threads] [-B batch] [-d ms] [-c] pattern...\n", argv[0]);
+				return 2;
+		}
+	}
+	if(optind>=argc){
+		fprintf(stderr, "Usage: %s [-r root] [-b backend] [-m matcher] [-o order] [-j threads] [-B batch] [-d ms] [-c] pattern...\n", argv[0]);
+		return 2;
+	}
+	o.patterns = (const char* const*) argv+optind;
+	o.pattern_count = argc-optind;
+	o.callback = print_batch;
+	o.arg = batches;
+	if(!(o.cancel = cancel = fs_cancel_create()))
+		return 1;
+	signal(SIGINT, on_interrupt);
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	fs_scan_stats st;
+	int result = fs_scan(&o, &st);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	if(result==fs_scan_error){
+		perror("fs_scan");
+		fs_cancel_free(cancel);
+		return 1;
+	}
+	fprintf(stderr, "%s: %llu dirs, %llu entries, %llu skipped, %llu matches in %zu batches, %.3f s\n", fs_scan_result_name(result),
+		(unsigned long long) st.dirs, (unsigned long long) st.entries, (unsigned long long) st.skipped, (unsigned long long) st.matches,
+		batches[0], (t1.tv_sec-t0.tv_sec)+(t1.tv_nsec-t0.tv_nsec)/1e9);
+	fs_cancel_free(cancel);
+	return 0;
+}
@@ -0,0 +1,276 @@
+/** @file fstrace.c
+ *  @brief Decoder of binary trace rings written by children started with -T.
+ *
+ * Tool maps trace rings (/dev/shm/fileseeker.<overlord pid>.<child index>) read-only, so it can be run while daemon works. Paths longer than event are joined with their extension records. It prints events as text, histogram of directory latency (time spent in directory itself, log2 buckets) and report of slowest directories.
+ *
+ * Usage: fstrace [-e] [-H] [-s n] ring...
+ *  @author Kacper Hącia
+ */
+
+#include "../src/trace.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** @brief decoded event with its whole path (joined with extension records) and index of ring it came from. */
+typedef struct decoded {
+	trace_event e;
+	char* path;
+	int worker;
+} decoded;
+
+static decoded* events = NULL;
+static size_t event_count = 0;
+
+static const char* type_name(int type){
+	switch (type) {
+		case trace_dir_enter:
+			return "enter";
+		case trace_dir_exit:
+			return "exit";
+		case trace_match:
+			return "match";
+		case trace_skip:
+			return "skip";
+		case trace_signal:
+			return "signal";
+		default:
+			return "?";
+	}
+}
+
+static const char* skip_name(int reason){
+	switch (reason) {
+		case trace_skip_access:
+			return "access";
+		case trace_skip_opendir:
+			return "opendir";
+		case trace_skip_interrupted:
+			return "interrupted";
+		case trace_skip_deadline:
+			return "deadline";
+		case trace_skip_limit:
+			return "limit";
+		case trace_skip_pruned:
+			return "pruned";
+		case trace_skip_timeout:
+			return "timeout";
+		case trace_skip_degraded:
+			return "degraded";
+		default:
+			return "?";
+	}
+}
+
+/** @brief maps ring file and copies its valid events.
+ * @return 0 on success; 1 on error.
+ */
+static int load_ring(const char* file){
+	char path[4096];
+	int fd = open(file, O_RDONLY);
+	if(fd<0 && !strchr(file, '/')){/** bare shm name */
+		snprintf(path, sizeof(path), "/dev/shm/%s", file);
+		fd = open(path, O_RDONLY);
+	}
+	if(fd<0){
+		perror(file);
+		return 1;
+	}
+	struct stat st;
+	if(fstat(fd, &st) || (size_t) st.st_size<sizeof(trace_ring)){
+		fprintf(stderr, "fstrace: %s: not a trace ring\n", file);
+		close(fd);
+		return 1;
+	}
+	const trace_ring* ring = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(ring==MAP_FAILED){
+		perror(file);
+		return 1;
+	}
+	if(ring->magic!=trace_magic || ring->version!=trace_version
+		|| sizeof(trace_ring)+sizeof(trace_event)*(size_t)ring->capacity>(size_t) st.st_size){
+		fprintf(stderr, "fstrace: %s: not a trace ring\n", file);
+		munmap((void*) ring, st.st_size);
+		return 1;
+	}
+	uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	uint64_t first = head>ring->capacity ? head-ring->capacity : 0;
+	decoded* tmp = realloc(events, sizeof(decoded)*(event_count+(head-first)));
+	if(!tmp)
+		abort();
+	events = tmp;
+	for(uint64_t n=first;n<head;n++){
+		const trace_event* e = ring->events + (n & (ring->capacity-1));
+		int type = __atomic_load_n(&e->type, __ATOMIC_ACQUIRE);
+		/** extension records are read with their event, the ones whose event was overwritten are dropped */
+		if(!type || type==trace_path_ext)
+			continue;
+		decoded* d = events+event_count;
+		d->e = *e;
+		d->e.path[trace_path_len-1] = 0;
+		d->worker = ring->index;
+		d->path = malloc(trace_path_len+(size_t) d->e.ext*trace_ext_len+4);
+		if(!d->path)
+			abort();
+		size_t len = strlen(d->e.path);
+		memcpy(d->path, d->e.path, len);
+		for(unsigned i=1;i<=d->e.ext;i++){
+			const trace_ext* x = (const trace_ext*) (ring->events + ((n+i) & (ring->capacity-1)));
+			if(n+i>=head || __atomic_load_n(&x->type, __ATOMIC_ACQUIRE)!=trace_path_ext || x->seq!=(uint8_t) i || x->len>trace_ext_len){
+				/** rewritten while we read */
+				memcpy(d->path+len, "...", 3);
+				len += 3;
+				break;
+			}
+			memcpy(d->path+len, x->text, x->len);
+			len += x->len;
+		}
+		d->path[len] = 0;
+		n += d->e.ext;
+		event_count++;
+	}
+	fprintf(stderr, "fstrace: %s: worker %d pid %d, %llu events written, %llu kept, sample 1/%u\n", file, ring->index, ring->pid,
+		(unsigned long long) head, (unsigned long long) (head-first), ring->sample);
+	munmap((void*) ring, st.st_size);
+	return 0;
+}
+
+static int by_time(const void* x, const void* y){
+	const decoded* a = x;
+	const decoded* b = y;
+	return (a->e.time_ns>b->e.time_ns) - (a->e.time_ns<b->e.time_ns);
+}
+
+static int by_latency(const void* x, const void* y){
+	const decoded* a = *(const decoded* const*) x;
+	const decoded* b = *(const decoded* const*) y;
+	return (a->e.latency_ns<b->e.latency_ns) - (a->e.latency_ns>b->e.latency_ns);
+}
+
+/** @brief prints all events as text. */
+static void print_events(){
+	uint64_t base = event_count ? events[0].e.time_ns : 0;
+	for(size_t i=0;i<event_count;i++){
+		const trace_event* e = &events[i].e;
+		printf("%14.6f w%-3d %-6s ", (e->time_ns-base)/1e9, events[i].worker, type_name(e->type));
+		switch (e->type) {
+			case trace_dir_enter:
+				printf("depth=%u %s\n", e->arg, events[i].path);
+			break;
+			case trace_dir_exit:
+				printf("depth=%u own=%.1fus total=%.1fus entries=%u %s\n", e->arg, e->latency_ns/1e3, e->total_ns/1e3, e->entries, events[i].path);
+			break;
+			case trace_match:
+				printf("%s %s\n", e->arg ? "dir" : "file", events[i].path);
+			break;
+			case trace_skip:
+				printf("reason=%s %s\n", skip_name(e->arg), events[i].path);
+			break;
+			case trace_signal:
+				printf("sig=%u\n", e->arg);
+			break;
+			default:
+				printf("\n");
+			break;
+		}
+	}
+}
+
+/** @brief prints log2 histogram of own latency of directories. */
+static void print_histogram(){
+	size_t buckets[64] = {0};
+	size_t total = 0;
+	for(size_t i=0;i<event_count;i++){
+		if(events[i].e.type!=trace_dir_exit)
+			continue;
+		uint64_t ns = events[i].e.latency_ns;
+		int b = 0;
+		while(ns>1 && b<63){
+			ns >>= 1;
+			b++;
+		}
+		buckets[b]++;
+		total++;
+	}
+	printf("directory latency (own time), %zu sampled directories:\n", total);
+	size_t max = 1;
+	for(int b=0;b<64;b++)
+		if(buckets[b]>max)
+			max = buckets[b];
+	for(int b=0;b<64;b++){
+		if(!buckets[b])
+			continue;
+		char bar[41];
+		int len = (int) (40*buckets[b]/max);
+		memset(bar, '#', len);
+		bar[len] = 0;
+		printf("%10.1fus - %10.1fus %9zu %s\n", (1ull<<b)/1e3, (2ull<<b)/1e3, buckets[b], bar);
+	}
+}
+
+/** @brief prints n directories with highest own latency. */
+static void print_slowest(size_t n){
+	const decoded** exits = malloc(sizeof(decoded*)*(event_count ? event_count : 1));
+	if(!exits)
+		abort();
+	size_t count = 0;
+	for(size_t i=0;i<event_count;i++)
+		if(events[i].e.type==trace_dir_exit)
+			exits[count++] = events+i;
+	qsort(exits, count, sizeof(decoded*), by_latency);
+	printf("slowest directories (own time / with subdirectories):\n");
+	for(size_t i=0;i<count && i<n;i++)
+		printf("%12.1fus %12.1fus %8u entries w%-3d %s\n", exits[i]->e.latency_ns/1e3, exits[i]->e.total_ns/1e3,
+			exits[i]->e.entries, exits[i]->worker, exits[i]->path);
+	free(exits);
+}
+
+int main(int argc, char** argv){
+	int text = 0, histogram = 0;
+	size_t slowest = 0;
+	int opt;
+	while((opt = getopt(argc, argv, "eHs:h"))!=-1){
+		switch (opt) {
+			case 'e':
+				text = 1;
+			break;
+			case 'H':
+				histogram = 1;
+			break;
+			case 's':
+				slowest = strtoul(optarg, NULL, 10);
+			break;
+			default:
+				fprintf(opt=='h' ? stdout : stderr, "Usage: %s [-e] [-H] [-s n] ring...\n"
+					"  -e    Prints events as text (default).\n"
+					"  -H    Prints histogram of directory latency.\n"
+					"  -s n  Prints n slowest directories.\n", argv[0]);
+				return opt=='h' ? 0 : 2;
+		}
+	}
+	if(optind==argc){
+		fprintf(stderr, "fstrace: no trace rings given (e.g. /dev/shm/fileseeker.*)\n");
+		return 2;
+	}
+	int err = 0;
+	for(int i=optind;i<argc;i++)
+		err |= load_ring(argv[i]);
+	qsort(events, event_count, sizeof(decoded), by_time);
+	if(!histogram && !slowest)
+		text = 1;
+	if(text)
+		print_events();
+	if(histogram)
+		print_histogram();
+	if(slowest)
+		print_slowest(slowest);
+	for(size_t i=0;i<event_count;i++)
+		free(events[i].path);
+	free(events);
+	return err;
+}